@@ -1,1132 +1,5456 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <regex>
 #include <ctime>
 #include <cstring>
 #include <algorithm>
 #include <sstream>
 #include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIBRARY_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIBRARY_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
+// Index into the interned string table (see intern()).
+typedef int Symbol;
+
+// Case-folded copy of a title plus its hash, cached on each Book so most
+// title comparisons are settled by the hash without touching the text.
+struct FoldedTitle {
+    string text;
+    size_t hash;
+};
+
 struct Book {
     string title;
-    string author;
+    FoldedTitle folded;
+    Symbol author;
     int year;
     int totalCopies;
     int availableCopies;
-    string category;
-    string addedDate;
+    Symbol category;
+    time_t addedDate;
     Book* prev;
     Book* next;
+    Book* categoryPrev;
+    Book* categoryNext;
+    int loanCount;
+    int column;
+    int serial;
 };
 
 
 struct BorrowRecord {
-    string bookTitle;
-    string bookCategory;
-    string borrowerName;
-    string borrowerId;
+    Book* book;
+    Symbol borrowerName;
+    Symbol borrowerId;
     int borrowedCopies;
-    string borrowDate;
-    string returnDate;
+    time_t borrowDate;
+    time_t returnDate;
     bool returned;
+    int recordNumber;
     BorrowRecord* next;
 };
 
-bool caseInsensitiveCompare(const string& str1, const string& str2) {
-    if (str1.length() != str2.length()) {
-        return false;
-    }
-    for (size_t i = 0; i < str1.length(); ++i) {
-        if (tolower(str1[i]) != tolower(str2[i])) {
+// ASCII case folding, the same mapping tolower() uses in the "C" locale.
+inline unsigned char foldChar(unsigned char c) {
+    return (unsigned char)(c - 'A') < 26 ? c | 0x20 : c;
+}
+
+bool foldedEqualsScalar(const char* a, const char* b, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (foldChar(a[i]) != foldChar(b[i])) {
             return false;
         }
     }
     return true;
 }
 
-Book* head = NULL;
-BorrowRecord* borrowHead = NULL;
-
-
-bool isDigit(char c) {
-    return c >= '0' && c <= '9';
+#ifdef LIBRARY_HAVE_SSE2
+// Sets bit 0x20 in every byte between 'A' and 'Z'. Bytes >= 0x80 compare as
+// negative and are left alone.
+inline __m128i foldBlock(__m128i v) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
 }
 
-bool isAlpha(char c) {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+bool foldedEqualsSSE2(const char* a, const char* b, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = foldBlock(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m128i y = foldBlock(_mm_loadu_si128((const __m128i*)(b + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+            return false;
+        }
+    }
+    return foldedEqualsScalar(a + i, b + i, size - i);
 }
-
-bool isValidInput(const string& input, const string& pattern, int minLength) {
-    if (input.length() < minLength) {
-        cout << " Input must be at least " << minLength << " characters long.\n";
-        return false;
+#endif
+
+#ifdef LIBRARY_HAVE_AVX2
+__attribute__((target("avx2")))
+bool foldedEqualsAVX2(const char* a, const char* b, size_t size) {
+    const __m256i below = _mm256_set1_epi8('A' - 1);
+    const __m256i above = _mm256_set1_epi8('Z' + 1);
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i xUpper = _mm256_and_si256(_mm256_cmpgt_epi8(x, below), _mm256_cmpgt_epi8(above, x));
+        __m256i yUpper = _mm256_and_si256(_mm256_cmpgt_epi8(y, below), _mm256_cmpgt_epi8(above, y));
+        x = _mm256_or_si256(x, _mm256_and_si256(xUpper, bit));
+        y = _mm256_or_si256(y, _mm256_and_si256(yUpper, bit));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1) {
+            return false;
+        }
     }
-    regex reg(pattern);
-    if (!regex_match(input, reg)) {
-        cout << " Invalid input format. Only letters and spaces allowed.\n";
-        return false;
+#ifdef LIBRARY_HAVE_SSE2
+    if (i + 16 <= size) {
+        __m128i x = foldBlock(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m128i y = foldBlock(_mm_loadu_si128((const __m128i*)(b + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+            return false;
+        }
+        i += 16;
     }
-    return true;
+#endif
+    return foldedEqualsScalar(a + i, b + i, size - i);
 }
+#endif
 
-bool getSafeInt(int& result, const string& prompt, int min, int max) {
-    string input;
-    while (true) {
-        cout << prompt;
-        getline(cin, input);
-        bool isValid = !input.empty();
-        for (char c : input) {
-            if (!isDigit(c)) {
-                isValid = false;
-                break;
-            }
-        }
+typedef bool (*FoldedEqualsFunction)(const char*, const char*, size_t);
 
-        if (!isValid) {
-            cout << " Invalid input. Please enter a valid number.\n";
-        } else {
-            result = stoi(input);
-            if (result >= min && result <= max) {
-                return true;
-            } else {
-                cout << " Please enter a number between " << min << " and " << max << ".\n";
-            }
-        }
+// Picks the widest compare the CPU supports; runs once at startup.
+FoldedEqualsFunction selectFoldedEquals() {
+#ifdef LIBRARY_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return foldedEqualsAVX2;
     }
+#endif
+#ifdef LIBRARY_HAVE_SSE2
+    return foldedEqualsSSE2;
+#else
+    return foldedEqualsScalar;
+#endif
 }
 
-string getCurrentDateTime() {
-    time_t now = time(0);
-    string dt = ctime(&now);
-    return dt.substr(0, dt.length()-1);
-}
+FoldedEqualsFunction foldedEquals = selectFoldedEquals();
 
-string calculateReturnDate(int days = 14) {
-    time_t now = time(0);
-    now += days * 24 * 60 * 60;
-    string dt = ctime(&now);
-    return dt.substr(0, dt.length()-1);
+bool caseInsensitiveCompare(const string& str1, const string& str2) {
+    return str1.length() == str2.length() &&
+           foldedEquals(str1.data(), str2.data(), str1.length());
 }
 
-time_t stringToTime(const string& dateStr) {
-    struct tm tm = {0};
-    istringstream iss(dateStr);
-    string day, month, timeStr, yearStr;
-    int dayNum, year;
-
-    iss >> day >> month >> dayNum >> timeStr >> yearStr;
+// Slab allocator for list nodes. Nodes are carved out of slabs of
+// NODES_PER_SLAB; freed nodes go on a free list and are reused before a new
+// slab is requested, and releaseAll() returns every slab in one pass.
+template <typename T>
+class NodePool {
+public:
+    static const size_t NODES_PER_SLAB = 4096;
+
+    NodePool() : freeList(NULL), nextSlot(NODES_PER_SLAB), nodesCreated(0), nodesReused(0) {}
+    ~NodePool() { releaseAll(); }
+
+    T* create(T&& value) {
+        void* slot;
+        if (freeList) {
+            slot = freeList;
+            freeList = *(void**)freeList;
+            nodesReused++;
+        } else {
+            if (nextSlot == NODES_PER_SLAB) {
+                slabs.push_back(new Slot[NODES_PER_SLAB]);
+                nextSlot = 0;
+            }
+            slot = &slabs.back()[nextSlot++];
+        }
+        nodesCreated++;
+        return new (slot) T(move(value));
+    }
 
-    size_t colon1 = timeStr.find(':');
-    size_t colon2 = timeStr.rfind(':');
-    int hour = stoi(timeStr.substr(0, colon1));
-    int minute = stoi(timeStr.substr(colon1+1, colon2-colon1-1));
-    int second = stoi(timeStr.substr(colon2+1));
+    void destroy(T* node) {
+        node->~T();
+        *(void**)node = freeList;
+        freeList = node;
+    }
 
-    const char* months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
-    int monthNum = 0;
-    for (int i = 0; i < 12; i++) {
-        if (month == months[i]) {
-            monthNum = i;
-            break;
+    // Frees all slabs without running destructors; callers destroy live
+    // nodes first (see cleanup()).
+    void releaseAll() {
+        for (size_t i = 0; i < slabs.size(); i++) {
+            delete[] slabs[i];
         }
+        slabs.clear();
+        freeList = NULL;
+        nextSlot = NODES_PER_SLAB;
     }
 
-    year = stoi(yearStr);
+    size_t created() const { return nodesCreated; }
+    size_t reused() const { return nodesReused; }
+    size_t slabAllocations() const { return slabs.size(); }
 
-    tm.tm_year = year - 1900;
-    tm.tm_mon = monthNum;
-    tm.tm_mday = dayNum;
-    tm.tm_hour = hour;
-    tm.tm_min = minute;
-    tm.tm_sec = second;
-    tm.tm_isdst = -1;
+private:
+    typedef typename aligned_storage<(sizeof(T) > sizeof(void*) ? sizeof(T) : sizeof(void*)),
+                                     alignof(T)>::type Slot;
 
-    return mktime(&tm);
+    vector<Slot*> slabs;
+    void* freeList;
+    size_t nextSlot;
+    size_t nodesCreated;
+    size_t nodesReused;
+};
+
+NodePool<Book> bookPool;
+NodePool<BorrowRecord> borrowPool;
+
+Book* head = NULL;
+Book* tail = NULL;
+BorrowRecord* borrowHead = NULL;
+BorrowRecord* borrowTail = NULL;
+int borrowRecordCount = 0;
+
+// One reader/writer lock guards the catalogue, the borrow ledger and every
+// index over them. Listings, lookups and searches hold it shared, so several
+// terminals can read at once; anything that changes a book, a loan or builds
+// an index holds it exclusively. The lock is not recursive: functions below
+// the menu level assume the caller already holds it.
+shared_timed_mutex libraryLock;
+typedef shared_lock<shared_timed_mutex> ReadLock;
+typedef unique_lock<shared_timed_mutex> WriteLock;
+
+// Hash index over the book list keyed by case-folded (category, title).
+// Duplicate keys are allowed in the list; the index keeps the first one
+// and a count so removals know whether another match must be promoted.
+struct BookIndexEntry {
+    Book* book;
+    int count;
+};
+
+unordered_map<string, BookIndexEntry> bookIndex;
+
+string foldCase(const string& str) {
+    string folded = str;
+    for (size_t i = 0; i < folded.size(); i++) {
+        folded[i] = foldChar(folded[i]);
+    }
+    return folded;
 }
 
-int daysBetweenDates(const string& date1, const string& date2) {
-    time_t t1 = stringToTime(date1);
-    time_t t2 = stringToTime(date2);
-    return difftime(t2, t1) / (60 * 60 * 24);
+FoldedTitle foldTitle(const string& title) {
+    FoldedTitle folded = {foldCase(title), 0};
+    folded.hash = hash<string>()(folded.text);
+    return folded;
 }
 
-void displayBookDetails(Book* book) {
-    cout << "\n--- Book Details ---\n";
-    cout << " Title: " << book->title << "\n";
-    cout << " Author: " << book->author << "\n";
-    cout << " Year: " << book->year << "\n";
-    cout << " Category: " << book->category << "\n";
-    cout << " Added on: " << book->addedDate << "\n";
-    cout << " Total copies: " << book->totalCopies << "\n";
-    cout << " Available copies: " << book->availableCopies << "\n";
-    float percentage = (book->totalCopies > 0) ? ((float)book->availableCopies / book->totalCopies * 100) : 0;
-    cout << " Status: " << percentage << "% available\n";
-    cout << "----------------------------------\n";
+bool titleMatches(const Book* book, const FoldedTitle& title) {
+    return book->folded.hash == title.hash && book->folded.text == title.text;
 }
 
-void displayBooksByCategory(const string& category) {
-    if (!head) {
-        cout << "No books in the library.\n";
-        return;
-    }
+// Interned strings for categories, authors and borrower names and IDs.
+// Every distinct case-folded string gets one Symbol, so the text is stored
+// once and case-insensitive comparisons become integer compares. The
+// spelling seen first is the one displayed.
+const Symbol NO_SYMBOL = -1;
 
-    Book* temp = head;
-    bool found = false;
+unordered_map<string, Symbol> symbolIds;
+vector<string> symbolNames;
 
-    cout << "\n--- Books in Category: " << category << " ---\n";
-    while (temp) {
-        if (caseInsensitiveCompare(temp->category, category)) {
-            found = true;
-            cout << " Title: " << temp->title << "\n";
-            cout << " Author: " << temp->author << "\n";
-            cout << " Year: " << temp->year << "\n";
-            cout << " Added on: " << temp->addedDate << "\n";
-            cout << " Copies: " << temp->availableCopies << "/" << temp->totalCopies << " available\n";
-            cout << "-------------------------\n";
-        }
-        temp = temp->next;
+Symbol intern(const string& str) {
+    string folded = foldCase(str);
+    auto it = symbolIds.find(folded);
+    if (it != symbolIds.end()) {
+        return it->second;
     }
+    Symbol id = symbolNames.size();
+    symbolIds[folded] = id;
+    symbolNames.push_back(str);
+    return id;
+}
 
-    if (!found) {
-        cout << " No books found in this category.\n";
+// Like intern(), but never adds: returns NO_SYMBOL for unseen strings.
+Symbol findSymbol(const string& str) {
+    auto it = symbolIds.find(foldCase(str));
+    return it == symbolIds.end() ? NO_SYMBOL : it->second;
+}
+
+const string& symbolName(Symbol id) {
+    return symbolNames[id];
+}
+
+string makeBookKey(Symbol category, const string& foldedTitle) {
+    return to_string(category) + '|' + foldedTitle;
+}
+
+void indexBook(Book* book) {
+    string key = makeBookKey(book->category, book->folded.text);
+    auto it = bookIndex.find(key);
+    if (it == bookIndex.end()) {
+        BookIndexEntry entry = {book, 1};
+        bookIndex[key] = entry;
+    } else {
+        it->second.count++;
     }
 }
 
-void displayAllBooks() {
-    if (!head) {
-        cout << "No books in the library.\n";
+void unindexBook(Book* book) {
+    auto it = bookIndex.find(makeBookKey(book->category, book->folded.text));
+    if (it == bookIndex.end()) {
         return;
     }
 
-    Book* temp = head;
-    Book* checker;
+    if (--it->second.count == 0) {
+        bookIndex.erase(it);
+        return;
+    }
 
-    while (temp) {
-        bool shown = false;
-        checker = head;
-        while (checker != temp) {
-            if (caseInsensitiveCompare(checker->category, temp->category)) {
-                shown = true;
+    if (it->second.book == book) {
+        Book* temp = head;
+        while (temp) {
+            if (temp != book && temp->category == book->category &&
+                titleMatches(temp, book->folded)) {
+                it->second.book = temp;
                 break;
             }
-            checker = checker->next;
-        }
-
-        if (!shown) {
-            displayBooksByCategory(temp->category);
+            temp = temp->next;
         }
-        temp = temp->next;
     }
 }
 
-int countCategories() {
-    int count = 0;
-    Book* temp = head;
-    Book* checker;
+Book* findBook(Symbol category, const string& title) {
+    auto it = bookIndex.find(makeBookKey(category, foldCase(title)));
+    return it == bookIndex.end() ? NULL : it->second.book;
+}
 
-    while (temp) {
-        bool found = false;
-        checker = head;
-        while (checker != temp) {
-            if (caseInsensitiveCompare(checker->category, temp->category)) {
-                found = true;
-                break;
-            }
-            checker = checker->next;
-        }
-        if (!found) count++;
-        temp = temp->next;
-    }
-    return count;
+Book* findBook(const string& category, const string& title) {
+    Symbol symbol = findSymbol(category);
+    return symbol == NO_SYMBOL ? NULL : findBook(symbol, title);
 }
 
-void showCategoryMenu() {
-    cout << "\n--------- Book Categories ----------\n";
-    Book* temp = head;
-    Book* checker;
-    int index = 1;
+// Registry of distinct categories in order of first appearance. Each
+// category keeps its own chain of books through categoryPrev/categoryNext
+// so menus and listings never rescan the whole list.
+struct Category {
+    Symbol symbol;
+    int bookCount;
+    Book* first;
+    Book* last;
+};
 
-    while (temp) {
-        bool shown = false;
-        checker = head;
-        while (checker != temp) {
-            if (caseInsensitiveCompare(checker->category, temp->category)) {
-                shown = true;
-                break;
-            }
-            checker = checker->next;
-        }
+vector<Category*> categories;
+unordered_map<Symbol, Category*> categoryIndex;
 
-        if (!shown) {
-            cout << index++ << ". " << temp->category << "\n";
-        }
-        temp = temp->next;
-    }
+Category* findCategory(Symbol symbol) {
+    auto it = categoryIndex.find(symbol);
+    return it == categoryIndex.end() ? NULL : it->second;
+}
 
-    cout << index << ". Back to Main Menu\n";
+Category* findCategory(const string& name) {
+    Symbol symbol = findSymbol(name);
+    return symbol == NO_SYMBOL ? NULL : findCategory(symbol);
 }
 
-string getCategoryByIndex(int index) {
-    Book* temp = head;
-    Book* checker;
-    int currentIndex = 1;
+void registerBook(Book* book) {
+    Category* cat = findCategory(book->category);
+    if (!cat) {
+        cat = new Category{book->category, 0, NULL, NULL};
+        categories.push_back(cat);
+        categoryIndex[book->category] = cat;
+    }
 
-    while (temp) {
-        bool foundEarlier = false;
-        checker = head;
-        while (checker != temp) {
-            if (caseInsensitiveCompare(checker->category, temp->category)) {
-                foundEarlier = true;
-                break;
-            }
-            checker = checker->next;
-        }
+    book->categoryPrev = cat->last;
+    book->categoryNext = NULL;
+    if (cat->last)
+        cat->last->categoryNext = book;
+    else
+        cat->first = book;
+    cat->last = book;
+    cat->bookCount++;
+}
 
-        if (!foundEarlier) {
-            if (currentIndex == index) {
-                return temp->category;
-            }
-            currentIndex++;
-        }
-        temp = temp->next;
+void unregisterBook(Book* book) {
+    Category* cat = findCategory(book->category);
+    if (!cat) {
+        return;
     }
-    return "";
-}
 
-string selectCategory() {
-    int totalCategories = countCategories();
-    int choice;
-    int totalOptions = totalCategories + 1;
+    if (book->categoryPrev)
+        book->categoryPrev->categoryNext = book->categoryNext;
+    else
+        cat->first = book->categoryNext;
 
-    while (true) {
-        showCategoryMenu();
-        if (!getSafeInt(choice, "Select category (or " + to_string(totalCategories+1) + " to exit): ", 1, totalOptions)) continue;
+    if (book->categoryNext)
+        book->categoryNext->categoryPrev = book->categoryPrev;
+    else
+        cat->last = book->categoryPrev;
 
-        if (choice <= totalCategories) {
-            return getCategoryByIndex(choice);
-        } else {
-            return "";
-        }
+    book->categoryPrev = NULL;
+    book->categoryNext = NULL;
+
+    if (--cat->bookCount == 0) {
+        categoryIndex.erase(cat->symbol);
+        categories.erase(find(categories.begin(), categories.end(), cat));
+        delete cat;
     }
 }
 
-void swapBooks(Book* a, Book* b) {
-    string tempTitle = a->title;
-    string tempAuthor = a->author;
-    int tempYear = a->year;
-    int tempTotal = a->totalCopies;
-    int tempAvailable = a->availableCopies;
-    string tempCategory = a->category;
-    string tempDate = a->addedDate;
+// Title search across all categories. titleOrder holds the serials of all
+// titles sorted by folded title, for prefix lookups. titleTrigrams maps each 3-byte
+// substring to the sorted serials of the titles containing it, and
+// wordTrigrams does the same for substrings that start a word, and
+// titleLengths[n] holds the serials of titles n bytes long. All of them
+// are built on the first search and maintained incrementally after that,
+// so loading the catalogue does not pay for them.
+vector<int> titleOrder;
+vector<vector<int> > titleTrigrams;
+vector<vector<int> > wordTrigrams;
+vector<vector<int> > titleLengths;
+vector<Book*> booksBySerial;
+bool titleSearchReady = false;
+
+const size_t SEARCH_RESULT_LIMIT = 10;
+
+// Trigrams are numbered over a 28-letter alphabet: a-z, space, and one
+// slot shared by every other byte. Sharing only adds candidates, which are
+// always checked against the full title.
+const int TRIGRAM_ALPHABET = 28;
+const int TRIGRAM_SLOTS = TRIGRAM_ALPHABET * TRIGRAM_ALPHABET * TRIGRAM_ALPHABET;
+
+enum TitleMatchRank {
+    MATCH_EXACT,
+    MATCH_PREFIX,
+    MATCH_WORD_START,
+    MATCH_SUBSTRING
+};
 
-    a->title = b->title;
-    a->author = b->author;
-    a->year = b->year;
-    a->totalCopies = b->totalCopies;
-    a->availableCopies = b->availableCopies;
-    a->category = b->category;
-    a->addedDate = b->addedDate;
+struct TitleMatch {
+    Book* book;
+    TitleMatchRank rank;
+};
 
-    b->title = tempTitle;
-    b->author = tempAuthor;
-    b->year = tempYear;
-    b->totalCopies = tempTotal;
-    b->availableCopies = tempAvailable;
-    b->category = tempCategory;
-    b->addedDate = tempDate;
+int trigramLetter(char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    return c == ' ' ? 26 : 27;
 }
 
-bool bookExists(const string& title, const string& author) {
-    Book* temp = head;
-    while (temp) {
-        if (caseInsensitiveCompare(temp->title, title) &&
-            caseInsensitiveCompare(temp->author, author)) {
-            return true;
+int trigramAt(const string& folded, size_t pos) {
+    return (trigramLetter(folded[pos]) * TRIGRAM_ALPHABET + trigramLetter(folded[pos + 1])) *
+           TRIGRAM_ALPHABET + trigramLetter(folded[pos + 2]);
+}
+
+// Distinct trigrams of a folded title; with wordStarts set, only those
+// that begin right after a space.
+vector<int> titleTrigramsOf(const string& folded, bool wordStarts) {
+    vector<int> trigrams;
+    for (size_t i = 0; i + 3 <= folded.size(); i++) {
+        if (!wordStarts || (i > 0 && folded[i - 1] == ' ')) {
+            trigrams.push_back(trigramAt(folded, i));
         }
-        temp = temp->next;
     }
-    return false;
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
 }
 
-void addBookToList(const string& title, const string& author, int year,
-                  const string& category, const string& addedDate,
-                  int totalCopies, int availableCopies) {
-    Book* newBook = new Book{title, author, year, totalCopies, availableCopies,
-                            category, addedDate, NULL, NULL};
-    if (!head) {
-        head = newBook;
+void addSerial(vector<int>& serials, int serial) {
+    if (serials.empty() || serials.back() < serial) {
+        serials.push_back(serial);
     } else {
-        Book* temp = head;
-        while (temp->next)
-            temp = temp->next;
-        temp->next = newBook;
-        newBook->prev = temp;
+        serials.insert(lower_bound(serials.begin(), serials.end(), serial), serial);
     }
 }
 
-void sortBooksByTitle(const string& category) {
-    if (!head || !head->next) {
-        cout << " Not enough books to sort.\n";
-        return;
+void removeSerial(vector<int>& serials, int serial) {
+    auto pos = lower_bound(serials.begin(), serials.end(), serial);
+    if (pos != serials.end() && *pos == serial) {
+        serials.erase(pos);
     }
+}
 
-    bool swapped;
-    Book *start = head;
-    Book *end = NULL;
+bool titleOrderLess(int serial, const string& folded) {
+    return booksBySerial[serial]->folded.text < folded;
+}
 
-    do {
-        swapped = false;
-        Book *current = start;
-
-        while (current->next != end) {
-            bool shouldSwap = false;
-
-            if (caseInsensitiveCompare(current->category, category) &&
-                caseInsensitiveCompare(current->next->category, category)) {
-                string title1 = current->title;
-                string title2 = current->next->title;
-                transform(title1.begin(), title1.end(), title1.begin(), ::tolower);
-                transform(title2.begin(), title2.end(), title2.begin(), ::tolower);
-                shouldSwap = title1 > title2;
-            }
+// Position of `book` in titleOrder, or where it would go.
+vector<int>::iterator titleOrderPosition(Book* book) {
+    vector<int>::iterator it = lower_bound(titleOrder.begin(), titleOrder.end(),
+                                           book->folded.text, titleOrderLess);
+    while (it != titleOrder.end() && *it != book->serial &&
+           booksBySerial[*it]->folded.text == book->folded.text) {
+        ++it;
+    }
+    return it;
+}
 
-            if (shouldSwap) {
-                swapBooks(current, current->next);
-                swapped = true;
-            }
-            current = current->next;
-        }
-        end = current;
-    } while (swapped);
+// The bucket of `buckets` for strings `length` bytes long, added on demand.
+vector<int>& lengthBucket(vector<vector<int> >& buckets, size_t length) {
+    if (buckets.size() <= length) {
+        buckets.resize(length + 1);
+    }
+    return buckets[length];
+}
 
-    saveToFile();
-    cout << "\nBooks in category '" << category << "' sorted by title:\n";
-    displayBooksByCategory(category);
+void addTrigrams(Book* book) {
+    addSerial(lengthBucket(titleLengths, book->folded.text.size()), book->serial);
+    vector<int> trigrams = titleTrigramsOf(book->folded.text, false);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        addSerial(titleTrigrams[trigrams[i]], book->serial);
+    }
+    trigrams = titleTrigramsOf(book->folded.text, true);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        addSerial(wordTrigrams[trigrams[i]], book->serial);
+    }
 }
 
-void sortBooksMenu() {
-    string category = selectCategory();
-    if (category.empty()) {
-        cout << "Sorting cancelled.\n";
+void addTitleTerms(Book* book) {
+    if (!titleSearchReady) {
         return;
     }
-
-    sortBooksByTitle(category);
+    titleOrder.insert(titleOrderPosition(book), book->serial);
+    addTrigrams(book);
 }
 
-void displayBooksMenu() {
-    int choice;
-    do {
-        cout << "\n---------- Display Options -----------\n";
-        cout << "1. Display All Books\n";
-        cout << "2. Display Books by Category\n";
-        cout << "3. Back to Main Menu\n";
+void removeTitleTerms(Book* book) {
+    if (!titleSearchReady) {
+        return;
+    }
+    vector<int>::iterator it = titleOrderPosition(book);
+    if (it != titleOrder.end() && *it == book->serial) {
+        titleOrder.erase(it);
+    }
+    removeSerial(lengthBucket(titleLengths, book->folded.text.size()), book->serial);
+    vector<int> trigrams = titleTrigramsOf(book->folded.text, false);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        removeSerial(titleTrigrams[trigrams[i]], book->serial);
+    }
+    trigrams = titleTrigramsOf(book->folded.text, true);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        removeSerial(wordTrigrams[trigrams[i]], book->serial);
+    }
+}
 
-        if (!getSafeInt(choice, "Enter your choice (1-3): ", 1, 3)) continue;
+void buildTitleSearch() {
+    titleSearchReady = true;
+    titleTrigrams.assign(TRIGRAM_SLOTS, vector<int>());
+    wordTrigrams.assign(TRIGRAM_SLOTS, vector<int>());
+    titleLengths.clear();
+    titleOrder.clear();
+    for (Book* temp = head; temp; temp = temp->next) {
+        titleOrder.push_back(temp->serial);
+        addTrigrams(temp);
+    }
+    sort(titleOrder.begin(), titleOrder.end(), [](int a, int b) {
+        return booksBySerial[a]->folded.text < booksBySerial[b]->folded.text;
+    });
+}
 
-        switch (choice) {
-            case 1:
-                displayAllBooks();
-                break;
-            case 2: {
-                string category = selectCategory();
-                if (!category.empty()) {
-                    displayBooksByCategory(category);
-                }
-                break;
+// Keeps the serials of `serials` that also appear in `other`. Both are
+// sorted; a much shorter list is probed with binary searches instead of
+// merged.
+void intersectSerials(vector<int>& serials, const vector<int>& other) {
+    vector<int> kept;
+    if (serials.size() * 16 < other.size()) {
+        for (size_t i = 0; i < serials.size(); i++) {
+            if (binary_search(other.begin(), other.end(), serials[i])) {
+                kept.push_back(serials[i]);
             }
-            case 3:
-                return;
         }
-    } while (true);
+    } else {
+        set_intersection(serials.begin(), serials.end(), other.begin(), other.end(), back_inserter(kept));
+    }
+    serials.swap(kept);
 }
 
-void saveToFile() {
-    ofstream file("library_data.txt");
-    Book* temp = head;
-    while (temp) {
-        file << temp->title << "|" << temp->author << "|" << temp->year << "|"
-             << temp->totalCopies << "|" << temp->availableCopies << "|"
-             << temp->category << "|" << temp->addedDate << "\n";
-        temp = temp->next;
+// Walks `candidates` in catalogue order and keeps those whose title
+// contains `pattern` somewhere after the start, stopping once `wanted`
+// are found. With `excludeWords` set, titles where the query also starts
+// a word are skipped, since the word-start pass already listed them.
+void collectTitleMatches(const vector<int>& candidates, const string& pattern, TitleMatchRank rank,
+                         const string& wordPattern, bool excludeWords, size_t wanted,
+                         vector<TitleMatch>& matches) {
+    size_t found = 0;
+    for (size_t i = 0; i < candidates.size() && found < wanted; i++) {
+        Book* book = booksBySerial[candidates[i]];
+        const string& text = book->folded.text;
+        if (text.find(pattern, 1) == string::npos ||
+            text.compare(0, wordPattern.size() - 1, wordPattern, 1, string::npos) == 0 ||
+            (excludeWords && text.find(wordPattern) != string::npos)) {
+            continue;
+        }
+        TitleMatch match = {book, rank};
+        matches.push_back(match);
+        found++;
     }
-    file.close();
 }
 
-void loadFromFile() {
-    ifstream file("library_data.txt");
-    string line;
-    bool isEmpty = true;
-
-    while (getline(file, line)) {
-        isEmpty = false;
-        string tokens[7];
-        size_t pos = 0;
-        int i = 0;
-        while ((pos = line.find('|')) != string::npos && i < 6) {
-            tokens[i++] = line.substr(0, pos);
-            line.erase(0, pos + 1);
-        }
-        tokens[6] = line;
+// Finds up to `limit` books whose title contains `query`, best first:
+// exact matches, then titles starting with the query (alphabetically),
+// then titles with a word starting with it, then any other substring
+// match (in catalogue order). Queries shorter than three characters only
+// match prefixes.
+vector<TitleMatch> searchTitles(const string& query, size_t limit) {
+    if (!titleSearchReady) {
+        buildTitleSearch();
+    }
 
-        if (i >= 6) {
-            string title = tokens[0];
-            string author = tokens[1];
-            int year = stoi(tokens[2]);
-            int totalCopies = stoi(tokens[3]);
-            int availableCopies = stoi(tokens[4]);
-            string category = tokens[5];
-            string addedDate = tokens[6];
+    vector<TitleMatch> matches;
+    string folded = foldCase(query);
+    if (folded.empty()) {
+        return matches;
+    }
 
-            addBookToList(title, author, year, category, addedDate, totalCopies, availableCopies);
+    // Prefix matches come out of titleOrder already in rank order, and they
+    // outrank every other kind of match.
+    for (vector<int>::iterator it = lower_bound(titleOrder.begin(), titleOrder.end(), folded, titleOrderLess);
+         it != titleOrder.end() && matches.size() < limit; ++it) {
+        Book* book = booksBySerial[*it];
+        if (book->folded.text.compare(0, folded.size(), folded) != 0) {
+            break;
         }
+        TitleMatch match = {book, book->folded.text.size() == folded.size() ? MATCH_EXACT : MATCH_PREFIX};
+        matches.push_back(match);
+    }
+    if (matches.size() == limit || folded.size() < 3) {
+        return matches;
     }
-    file.close();
 
-    if (isEmpty) {
-        string dt = getCurrentDateTime();
-        addBookToList("Fikir Ena Desita", "Hana Gebreegziabher", 2005, "Fiction", dt, 3, 3);
-        addBookToList("Sew LeSew", "Aregawi Desalegn", 1998, "History", dt, 2, 2);
-        addBookToList("Yetintawi Tarik Tarik", "Molla Abebe", 2010, "Fiction", dt, 1, 1);
-        addBookToList("Introduction to Algorithms", "Thomas H. Cormen", 2009, "Computer Science", dt, 5, 5);
-        addBookToList("Clean Code", "Robert C. Martin", 2008, "Computer Science", dt, 4, 4);
-        saveToFile();
+    // Every match appears in the list of each of the query's trigrams, so
+    // intersect them, rarest first, until few candidates are left. Word-start
+    // matches must also be in the word list of the first trigram.
+    vector<const vector<int>*> lists;
+    vector<int> trigrams = titleTrigramsOf(folded, false);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        lists.push_back(&titleTrigrams[trigrams[i]]);
     }
-}
+    sort(lists.begin(), lists.end(),
+         [](const vector<int>* a, const vector<int>* b) { return a->size() < b->size(); });
 
-void countBooksInCategory(const string& category) {
-    if (!head) {
-        cout << "No books in the library.\n";
-        return;
+    vector<int> candidates = *lists[0];
+    for (size_t i = 1; i < lists.size() && candidates.size() > limit; i++) {
+        intersectSerials(candidates, *lists[i]);
     }
+    vector<int> wordCandidates = wordTrigrams[trigramAt(folded, 0)];
+    intersectSerials(wordCandidates, candidates);
+
+    string wordPattern = " " + folded;
+    collectTitleMatches(wordCandidates, wordPattern, MATCH_WORD_START, wordPattern, false,
+                        limit - matches.size(), matches);
+    collectTitleMatches(candidates, folded, MATCH_SUBSTRING, wordPattern, true,
+                        limit - matches.size(), matches);
+    return matches;
+}
 
-    int bookCount = 0;
-    int totalCopies = 0;
-    int availableCopies = 0;
-    Book* temp = head;
+// Typo-tolerant suggestions for titles and authors. Candidates come from
+// the trigram lists: a string within k edits of the query still shares all
+// but at most 4k of the query's distinct trigrams (an edit touches three,
+// an adjacent swap four), so only strings reaching that count are checked
+// with the real edit distance. A query with at most 4k trigrams (a short
+// one, like "Mody" for "Moby") can be that close without sharing any, so
+// it is checked against every string of a length within k instead. Author
+// trigrams and lengths are indexed by symbol, built on first use like the
+// title index. authorBookCounts[author] counts the
+// author's live books; the terms go in with the first and out with the last,
+// so deleted or re-authored books stop producing suggestions.
+vector<vector<int> > authorTrigrams;
+vector<vector<int> > authorLengths;
+vector<int> authorBookCounts;
+bool authorSearchReady = false;
+
+const size_t SUGGESTION_LIMIT = 5;
+
+struct FuzzyMatch {
+    int id;
+    int distance;
+};
 
-    while (temp) {
-        if (caseInsensitiveCompare(temp->category, category)) {
-            bookCount++;
-            totalCopies += temp->totalCopies;
-            availableCopies += temp->availableCopies;
-        }
-        temp = temp->next;
+void addAuthorTerms(Symbol author) {
+    if (!authorSearchReady) {
+        return;
+    }
+    if (authorBookCounts.size() <= (size_t)author) {
+        authorBookCounts.resize(author + 1, 0);
+    }
+    if (authorBookCounts[author]++ > 0) {
+        return;
+    }
+    string folded = foldCase(symbolName(author));
+    addSerial(lengthBucket(authorLengths, folded.size()), author);
+    vector<int> trigrams = titleTrigramsOf(folded, false);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        addSerial(authorTrigrams[trigrams[i]], author);
     }
-
-    cout << "\n--- Book Count for Category: " << category << " ---\n";
-    cout << " Number of unique titles: " << bookCount << "\n";
-    cout << " Total copies: " << totalCopies << "\n";
-    cout << " Available copies: " << availableCopies << "\n";
-    cout << " Checked out copies: " << (totalCopies - availableCopies) << "\n";
-    cout << "-------------------------\n";
 }
 
-void countAllBooks() {
-    if (!head) {
-        cout << "No books in the library.\n";
+void removeAuthorTerms(Symbol author) {
+    if (!authorSearchReady || (size_t)author >= authorBookCounts.size() || authorBookCounts[author] == 0) {
         return;
     }
-
-    int bookCount = 0;
-    int totalCopies = 0;
-    int availableCopies = 0;
-    Book* temp = head;
-
-    while (temp) {
-        bookCount++;
-        totalCopies += temp->totalCopies;
-        availableCopies += temp->availableCopies;
-        temp = temp->next;
+    if (--authorBookCounts[author] > 0) {
+        return;
+    }
+    string folded = foldCase(symbolName(author));
+    removeSerial(lengthBucket(authorLengths, folded.size()), author);
+    vector<int> trigrams = titleTrigramsOf(folded, false);
+    for (size_t i = 0; i < trigrams.size(); i++) {
+        removeSerial(authorTrigrams[trigrams[i]], author);
     }
+}
 
-    cout << "\n--- Total Library Statistics ---\n";
-    cout << " Number of unique titles: " << bookCount << "\n";
-    cout << " Total copies: " << totalCopies << "\n";
-    cout << " Available copies: " << availableCopies << "\n";
-    cout << " Checked out copies: " << (totalCopies - availableCopies) << "\n";
-    cout << "-------------------------\n";
+void buildAuthorSearch() {
+    authorSearchReady = true;
+    authorTrigrams.assign(TRIGRAM_SLOTS, vector<int>());
+    authorLengths.clear();
+    authorBookCounts.clear();
+    for (Book* temp = head; temp; temp = temp->next) {
+        addAuthorTerms(temp->author);
+    }
 }
 
-void addBooks() {
-    int count;
-    if (!getSafeInt(count, "Enter the number of books to add (1-100): ", 1, 100)) return;
+// Optimal string alignment distance (insertions, deletions, substitutions
+// and adjacent swaps), capped at maxDistance + 1. Only cells within
+// maxDistance of the diagonal can stay under the cap, so only that band of
+// each row is computed, and the scan stops once a whole band exceeds it.
+int boundedEditDistance(const string& a, const string& b, int maxDistance) {
+    int rows = a.size(), columns = b.size();
+    if (rows - columns > maxDistance || columns - rows > maxDistance) {
+        return maxDistance + 1;
+    }
 
-    for (int i = 0; i < count; i++) {
-        cout << "\n--- Adding Book #" << i+1 << " ---\n";
+    const int over = maxDistance + 1;
+    static thread_local vector<int> beforePrevious, previous, current;
+    beforePrevious.assign(columns + 1, over);
+    previous.assign(columns + 1, over);
+    current.assign(columns + 1, over);
+    for (int j = 0; j <= min(columns, maxDistance); j++) {
+        previous[j] = j;
+    }
 
-        string category = selectCategory();
-        if (category.empty()) {
-            cout << "Returning to main menu.\n";
-            return;
+    for (int i = 1; i <= rows; i++) {
+        int from = max(1, i - maxDistance);
+        int to = min(columns, i + maxDistance);
+        current[from - 1] = from == 1 && i <= maxDistance ? i : over;
+        int rowMin = current[from - 1];
+        for (int j = from; j <= to; j++) {
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            int best = min(min(previous[j] + 1, current[j - 1] + 1), previous[j - 1] + cost);
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                best = min(best, beforePrevious[j - 2] + 1);
+            }
+            current[j] = min(best, over);
+            rowMin = min(rowMin, current[j]);
         }
+        if (to < columns) {
+            current[to + 1] = over;
+        }
+        if (rowMin > maxDistance) {
+            return over;
+        }
+        beforePrevious.swap(previous);
+        previous.swap(current);
+    }
+    return previous[columns];
+}
 
-        string title, author;
-        int year, totalCopies;
+// Edits allowed for a query: one for short strings, up to three for long.
+int allowedEdits(const string& folded) {
+    return folded.size() <= 5 ? 1 : folded.size() <= 12 ? 2 : 3;
+}
 
-        do {
-            cout << "Enter book title (minimum 4 letters, letters and spaces only): ";
-            getline(cin, title);
-        } while (!isValidInput(title, "^[a-zA-Z ]+$", 4));
+// Ids from `lists` that share enough of the query's trigrams to be within
+// maxEdits of it, or, for a query with too few trigrams, every id in the
+// `lengths` buckets within maxEdits of its length. `idCount` bounds the ids
+// that can appear.
+vector<int> fuzzyCandidates(const vector<vector<int> >& lists, const vector<vector<int> >& lengths,
+                            const string& folded, int maxEdits, size_t idCount) {
+    vector<int> candidates;
+    vector<int> trigrams = titleTrigramsOf(folded, false);
+    int needed = (int)trigrams.size() - 4 * maxEdits;
+    if (needed <= 0) {
+        size_t from = folded.size() > (size_t)maxEdits ? folded.size() - maxEdits : 0;
+        for (size_t n = from; n <= folded.size() + maxEdits && n < lengths.size(); n++) {
+            candidates.insert(candidates.end(), lengths[n].begin(), lengths[n].end());
+        }
+        return candidates;
+    }
 
-        do {
-            cout << "Enter author name (minimum 4 letters, letters and spaces only): ";
-            getline(cin, author);
-        } while (!isValidInput(author, "^[a-zA-Z ]+$", 4));
-
-        if (bookExists(title, author)) {
-            Book* temp = head;
-            while (temp) {
-                if (caseInsensitiveCompare(temp->title, title) &&
-                    caseInsensitiveCompare(temp->author, author)) {
-                    cout << "Enter additional copies to add (1-1000): ";
-                    if (!getSafeInt(totalCopies, "", 1, 1000)) return;
-
-                    int newTotal = temp->totalCopies + totalCopies;
-                    int newAvailable = temp->availableCopies + totalCopies;
-                    temp->totalCopies = newTotal;
-                    temp->availableCopies = newAvailable;
-                    cout << "Book already exists. Added " << totalCopies << " more copies.\n";
-                    cout << " New total: " << newTotal << " copies (" << newAvailable << " available)\n";
-                    saveToFile();
-                    break;
-                }
-                temp = temp->next;
+    static thread_local vector<uint16_t> shared;
+    if (shared.size() < idCount) {
+        shared.resize(idCount, 0);
+    }
+    vector<int> touched;
+    for (size_t t = 0; t < trigrams.size(); t++) {
+        const vector<int>& ids = lists[trigrams[t]];
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (shared[ids[i]]++ == 0) {
+                touched.push_back(ids[i]);
             }
-        } else {
-            if (!getSafeInt(year, "Enter year of publication (1800-2025): ", 1800, 2025)) return;
-            if (!getSafeInt(totalCopies, "Enter total number of copies (1-1000): ", 1, 1000)) return;
-
-            string dt = getCurrentDateTime();
-            addBookToList(title, author, year, category, dt, totalCopies, totalCopies);
-            cout << "Book added successfully with " << totalCopies << " copies.\n";
         }
     }
-    saveToFile();
-}
-
-void searchBooks() {
-    string category = selectCategory();
-    if (category.empty()) {
-        cout << "Returning to main menu.\n";
-        return;
+    for (size_t i = 0; i < touched.size(); i++) {
+        if (shared[touched[i]] >= needed) {
+            candidates.push_back(touched[i]);
+        }
+        shared[touched[i]] = 0;
     }
+    return candidates;
+}
 
-    string title;
-    cout << "Enter title to search in category '" << category << "': ";
-    getline(cin, title);
-
-    Book* temp = head;
-    bool found = false;
+bool fuzzyMatchBefore(const FuzzyMatch& a, const FuzzyMatch& b) {
+    return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+}
 
-    while (temp) {
-        if (caseInsensitiveCompare(temp->category, category) &&
-            caseInsensitiveCompare(temp->title, title)) {
-            displayBookDetails(temp);
-            found = true;
-            break;
-        }
-        temp = temp->next;
+// Books whose whole title is within a few edits of `query`, closest first.
+vector<FuzzyMatch> suggestTitles(const string& query, size_t limit) {
+    if (!titleSearchReady) {
+        buildTitleSearch();
     }
-
-    if (!found) {
-        cout << " Book not found in category '" << category << "'.\n";
+    string folded = foldCase(query);
+    int maxEdits = allowedEdits(folded);
+    vector<int> candidates = fuzzyCandidates(titleTrigrams, titleLengths, folded, maxEdits, booksBySerial.size());
+
+    vector<FuzzyMatch> matches;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        int distance = boundedEditDistance(folded, booksBySerial[candidates[i]]->folded.text, maxEdits);
+        if (distance <= maxEdits) {
+            FuzzyMatch match = {candidates[i], distance};
+            matches.push_back(match);
+        }
     }
+    size_t kept = min(limit, matches.size());
+    partial_sort(matches.begin(), matches.begin() + kept, matches.end(), fuzzyMatchBefore);
+    matches.resize(kept);
+    return matches;
 }
 
-void deleteBook() {
-    string category = selectCategory();
-    if (category.empty()) {
-        cout << "Returning to main menu.\n";
-        return;
+// Authors whose name is within a few edits of `query`, closest first.
+vector<FuzzyMatch> suggestAuthors(const string& query, size_t limit) {
+    if (!authorSearchReady) {
+        buildAuthorSearch();
     }
-
-    string title;
-    cout << "Enter title to delete from category '" << category << "': ";
-    getline(cin, title);
-
-    Book* temp = head;
-    while (temp) {
-        if (caseInsensitiveCompare(temp->category, category) &&
-            caseInsensitiveCompare(temp->title, title)) {
-            displayBookDetails(temp);
-
-            int copiesToDelete;
-            if (!getSafeInt(copiesToDelete, "Enter number of copies to delete (1-" + to_string(temp->totalCopies) + "): ", 1, temp->totalCopies)) {
-                return;
-            }
-
-            if (copiesToDelete > temp->availableCopies) {
-                cout << " Warning: You're trying to delete more copies than are currently available.\n";
-                cout << " Only " << temp->availableCopies << " copies are available to delete.\n";
-
-                char confirm;
-                cout << " Do you want to proceed? (y/n): ";
-                cin >> confirm;
-                cin.ignore();
-
-                if (tolower(confirm) != 'y') {
-                    cout << " Delete operation cancelled.\n";
-                    return;
-                }
-            }
-
-            string deletionTime = getCurrentDateTime();
-            string deletionDetails = "Deleted " + to_string(copiesToDelete) +
-                                   " copies of '" + title +
-                                   "' from category '" + category +
-                                   "' on " + deletionTime;
-
-            if (copiesToDelete == temp->totalCopies) {
-                if (temp->prev)
-                    temp->prev->next = temp->next;
-                else
-                    head = temp->next;
-
-                if (temp->next)
-                    temp->next->prev = temp->prev;
-
-                delete temp;
-                cout << " Book record completely deleted.\n";
-            } else {
-                temp->totalCopies -= copiesToDelete;
-                temp->availableCopies = max(0, temp->availableCopies - copiesToDelete);
-                cout << " " << copiesToDelete << " copies removed from inventory.\n";
-                displayBookDetails(temp);
-            }
-
-            ofstream logfile("library_deletions.log", ios::app);
-            if (logfile.is_open()) {
-                logfile << deletionDetails << "\n";
-                logfile.close();
-            }
-
-            saveToFile();
-            cout << " Deletion logged: " << deletionDetails << "\n";
-            return;
+    string folded = foldCase(query);
+    int maxEdits = allowedEdits(folded);
+    vector<int> candidates = fuzzyCandidates(authorTrigrams, authorLengths, folded, maxEdits, symbolNames.size());
+
+    vector<FuzzyMatch> matches;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        int distance = boundedEditDistance(folded, foldCase(symbolName(candidates[i])), maxEdits);
+        if (distance <= maxEdits) {
+            FuzzyMatch match = {candidates[i], distance};
+            matches.push_back(match);
         }
-        temp = temp->next;
     }
-    cout << " Book not found in category '" << category << "'.\n";
+    size_t kept = min(limit, matches.size());
+    partial_sort(matches.begin(), matches.begin() + kept, matches.end(), fuzzyMatchBefore);
+    matches.resize(kept);
+    return matches;
 }
 
-void updateBook() {
-    cout << "\n===== Update Book =====\n";
-
-    string category = selectCategory();
-    if (category.empty()) {
-        cout << "Update cancelled.\n";
+// Prints close title (and optionally author) matches after a failed lookup.
+void printSuggestions(const string& query, bool includeAuthors) {
+    vector<FuzzyMatch> titles = suggestTitles(query, SUGGESTION_LIMIT);
+    vector<FuzzyMatch> authors;
+    if (includeAuthors) {
+        authors = suggestAuthors(query, SUGGESTION_LIMIT);
+    }
+    if (titles.empty() && authors.empty()) {
         return;
     }
 
-    string title;
-    cout << "Enter title of the book to update in category '" << category << "': ";
-    getline(cin, title);
+    cout << " Did you mean:\n";
+    for (size_t i = 0; i < titles.size(); i++) {
+        Book* book = booksBySerial[titles[i].id];
+        cout << "  - " << book->title << " by " << symbolName(book->author)
+             << " [" << symbolName(book->category) << "]\n";
+    }
+    for (size_t i = 0; i < authors.size(); i++) {
+        cout << "  - author " << symbolName(authors[i].id) << "\n";
+    }
+}
 
-    Book* temp = head;
-    while (temp) {
-        if (caseInsensitiveCompare(temp->category, category) &&
-            caseInsensitiveCompare(temp->title, title)) {
-            cout << "\n--- Current Book Information ---";
-            displayBookDetails(temp);
+void renameBook(Book* book, const string& newTitle, Symbol newCategory) {
+    bool categoryChanged = book->category != newCategory;
+    unindexBook(book);
+    removeTitleTerms(book);
+    if (categoryChanged) {
+        unregisterBook(book);
+    }
 
-            cout << "\nEnter new details for the book (leave blank to keep current value):\n";
+    book->title = newTitle;
+    book->folded = foldTitle(newTitle);
+    book->category = newCategory;
 
-            string newTitle;
-            cout << "Enter new title [" << temp->title << "]: ";
-            getline(cin, newTitle);
-            if (!newTitle.empty()) {
-                while (!isValidInput(newTitle, "^[a-zA-Z ]+$", 4)) {
-                    cout << "Enter new title [" << temp->title << "]: ";
-                    getline(cin, newTitle);
-                    if (newTitle.empty()) break;
-                }
-                if (!newTitle.empty()) {
-                    if (bookExists(newTitle, temp->author)) {
-                        cout << "A book with this title and author already exists.\n";
-                        return;
-                    }
-                    temp->title = newTitle;
-                }
-            }
+    indexBook(book);
+    addTitleTerms(book);
+    if (categoryChanged) {
+        registerBook(book);
+    }
+}
 
-            string newAuthor;
-            cout << "Enter new author [" << temp->author << "]: ";
-            getline(cin, newAuthor);
-            if (!newAuthor.empty()) {
-                while (!isValidInput(newAuthor, "^[a-zA-Z ]+$", 4)) {
-                    cout << "Enter new author [" << temp->author << "]: ";
-                    getline(cin, newAuthor);
-                    if (newAuthor.empty()) break;
-                }
-                if (!newAuthor.empty()) {
-                    if (bookExists(temp->title, newAuthor)) {
-                        cout << "A book with this title and author already exists.\n";
-                        return;
-                    }
-                    temp->author = newAuthor;
-                }
-            }
+// Columnar copy of the numeric fields of every live book, so statistics run
+// as flat loops over contiguous arrays instead of chasing list pointers.
+// Slot i belongs to owners[i] and Book::column points back at it; removal
+// moves the last slot into the hole.
+struct CatalogueColumns {
+    vector<int> year;
+    vector<int> totalCopies;
+    vector<int> availableCopies;
+    vector<Symbol> category;
+    vector<Book*> owners;
+};
 
-            cout << "\nCurrent category: " << temp->category << endl;
-            cout << "Select new category:\n";
-            string newCategory = selectCategory();
-            if (!newCategory.empty()) {
-                temp->category = newCategory;
-            }
+CatalogueColumns columns;
 
-            string yearInput;
-            int newYear;
-            cout << "Enter new year [" << temp->year << "]: ";
-            getline(cin, yearInput);
-            if (!yearInput.empty()) {
-                while (true) {
-                    bool valid = true;
-                    for (char c : yearInput) {
-                        if (!isDigit(c)) {
-                            valid = false;
-                            break;
-                        }
-                    }
-                    if (valid) {
-                        newYear = stoi(yearInput);
-                        if (newYear >= 1800 && newYear <= 2025) {
-                            temp->year = newYear;
-                            break;
-                        }
-                    }
-                    cout << "Please enter a valid year between 1800 and 2025 [" << temp->year << "]: ";
-                    getline(cin, yearInput);
-                    if (yearInput.empty()) break;
-                }
-            }
+void addBookColumns(Book* book) {
+    book->column = columns.owners.size();
+    columns.year.push_back(book->year);
+    columns.totalCopies.push_back(book->totalCopies);
+    columns.availableCopies.push_back(book->availableCopies);
+    columns.category.push_back(book->category);
+    columns.owners.push_back(book);
+}
 
-            string copiesInput;
-            int newTotalCopies;
-            cout << "Enter new total copies [" << temp->totalCopies << "]: ";
-            getline(cin, copiesInput);
-            if (!copiesInput.empty()) {
-                while (true) {
-                    bool valid = true;
-                    for (char c : copiesInput) {
-                        if (!isDigit(c)) {
-                            valid = false;
-                            break;
-                        }
-                    }
-                    if (valid) {
-                        newTotalCopies = stoi(copiesInput);
-                        if (newTotalCopies >= 1 && newTotalCopies <= 1000) {
-                            int difference = newTotalCopies - temp->totalCopies;
-                            temp->availableCopies += difference;
-                            if (temp->availableCopies < 0) temp->availableCopies = 0;
-                            if (temp->availableCopies > newTotalCopies) temp->availableCopies = newTotalCopies;
-                            temp->totalCopies = newTotalCopies;
-                            break;
-                        }
-                    }
-                    cout << "Please enter a valid number between 1 and 1000 [" << temp->totalCopies << "]: ";
-                    getline(cin, copiesInput);
-                    if (copiesInput.empty()) break;
-                }
-            }
+void syncBookColumns(Book* book) {
+    int slot = book->column;
+    columns.year[slot] = book->year;
+    columns.totalCopies[slot] = book->totalCopies;
+    columns.availableCopies[slot] = book->availableCopies;
+    columns.category[slot] = book->category;
+}
 
-            saveToFile();
-            cout << "\nBook updated successfully!\n";
-            cout << "--- Updated Book Information ---";
-            displayBookDetails(temp);
-            return;
-        }
-        temp = temp->next;
+void removeBookColumns(Book* book) {
+    int slot = book->column;
+    int last = columns.owners.size() - 1;
+    if (slot != last) {
+        columns.year[slot] = columns.year[last];
+        columns.totalCopies[slot] = columns.totalCopies[last];
+        columns.availableCopies[slot] = columns.availableCopies[last];
+        columns.category[slot] = columns.category[last];
+        columns.owners[slot] = columns.owners[last];
+        columns.owners[slot]->column = slot;
     }
-    cout << "Book not found in category '" << category << "'.\n";
+    columns.year.pop_back();
+    columns.totalCopies.pop_back();
+    columns.availableCopies.pop_back();
+    columns.category.pop_back();
+    columns.owners.pop_back();
+    book->column = -1;
 }
 
-void saveBorrowRecords() {
-ofstream file("borrow_records.txt");
-BorrowRecord* temp = borrowHead;
-while (temp) {
-    file << temp->bookTitle << "|" << temp->bookCategory << "|"
-         << temp->borrowerName << "|" << temp->borrowerId << "|"
-         << temp->borrowedCopies << "|" << temp->borrowDate << "|"
-         << temp->returnDate << "|" << (temp->returned ? "1" : "0") << "\n";
-    temp = temp->next;
-}
-file.close();
-}
+struct CatalogueStats {
+    int bookCount;
+    long long totalCopies;
+    long long availableCopies;
+    int oldestYear;
+    int newestYear;
+};
 
-void loadBorrowRecords() {
-ifstream file("borrow_records.txt");
-string line;
+// Sums over the books of one category, or over all books when category is
+// NO_SYMBOL. The loop body is branch-free (non-matching slots are masked
+// out) so the compiler can vectorize it.
+CatalogueStats columnStats(Symbol category) {
+    const int* year = columns.year.data();
+    const int* total = columns.totalCopies.data();
+    const int* available = columns.availableCopies.data();
+    const Symbol* cat = columns.category.data();
+    size_t size = columns.owners.size();
+    bool all = category == NO_SYMBOL;
 
-while (getline(file, line)) {
-    string tokens[8];
-    size_t pos = 0;
-    int i = 0;
-    while ((pos = line.find('|')) != string::npos && i < 7) {
-        tokens[i++] = line.substr(0, pos);
-        line.erase(0, pos + 1);
+    int count = 0;
+    long long totalSum = 0;
+    long long availableSum = 0;
+    int oldest = INT32_MAX;
+    int newest = INT32_MIN;
+    for (size_t i = 0; i < size; i++) {
+        int match = all | (cat[i] == category);
+        int mask = -match;
+        count += match;
+        totalSum += total[i] & mask;
+        availableSum += available[i] & mask;
+        oldest = min(oldest, match ? year[i] : INT32_MAX);
+        newest = max(newest, match ? year[i] : INT32_MIN);
     }
-    tokens[7] = line;
 
-    if (i >= 7) {
-        BorrowRecord* newRecord = new BorrowRecord{
-            tokens[0], tokens[1], tokens[2], tokens[3],
-            stoi(tokens[4]), tokens[5], tokens[6],
-            tokens[7] == "1", NULL
-        };
+    CatalogueStats stats = {count, totalSum, availableSum, oldest, newest};
+    return stats;
+}
 
-        if (!borrowHead) {
-            borrowHead = newRecord;
-        } else {
-            BorrowRecord* temp = borrowHead;
-            while (temp->next) {
-                temp = temp->next;
-            }
-            temp->next = newRecord;
+// Same result computed by walking the book list; kept for --bench-stats.
+CatalogueStats listStats(Symbol category) {
+    CatalogueStats stats = {0, 0, 0, INT32_MAX, INT32_MIN};
+    for (Book* temp = head; temp; temp = temp->next) {
+        if (category == NO_SYMBOL || temp->category == category) {
+            stats.bookCount++;
+            stats.totalCopies += temp->totalCopies;
+            stats.availableCopies += temp->availableCopies;
+            stats.oldestYear = min(stats.oldestYear, temp->year);
+            stats.newestYear = max(stats.newestYear, temp->year);
         }
     }
+    return stats;
 }
-file.close();
-}
-
-void addBorrowRecord(const string& title, const string& category, const string& name,
-                const string& id, int copies, const string& borrowDate,
-                const string& returnDate) {
-BorrowRecord* newRecord = new BorrowRecord{
-    title, category, name, id, copies, borrowDate, returnDate, false, NULL
-};
 
-if (!borrowHead) {
-    borrowHead = newRecord;
-} else {
-    BorrowRecord* temp = borrowHead;
-    while (temp->next) {
-        temp = temp->next;
+// Secondary indexes for findBooks(): books by author and by publication
+// year. Like the title index they are built on the first query and kept
+// current afterwards by addBookToList, removeBook, changeAuthor and
+// changeYear.
+unordered_map<Symbol, vector<Book*> > authorIndex;
+map<int, vector<Book*> > yearIndex;
+bool queryIndexReady = false;
+
+void eraseBook(vector<Book*>& books, Book* book) {
+    vector<Book*>::iterator it = find(books.begin(), books.end(), book);
+    if (it != books.end()) {
+        books.erase(it);
     }
-    temp->next = newRecord;
-}
-saveBorrowRecords();
 }
 
-void displayBorrowRules() {
-cout << "\n--------- Borrowing Rules -----------\n";
-cout << "1. You can borrow one copy of any book, but not multiple copies of the same book.\n";
-cout << "2. The standard borrowing period is 14 days.\n";
-cout << "3. Late returns will incur a fine of 5 birr per day.\n";
-cout << "4. Books must be returned in the same condition as borrowed.\n";
-cout << "5. Lost or damaged books must be replaced or paid for.\n";
-cout << "-----------------------------------------------\n";
+void addQueryTerms(Book* book) {
+    if (!queryIndexReady) {
+        return;
+    }
+    authorIndex[book->author].push_back(book);
+    yearIndex[book->year].push_back(book);
 }
 
-bool hasBorrowedSpecificBook(const string& borrowerId, const string& title, const string& category) {
-BorrowRecord* temp = borrowHead;
-while (temp) {
-    if (caseInsensitiveCompare(temp->borrowerId, borrowerId) &&
-        caseInsensitiveCompare(temp->bookTitle, title) &&
-        caseInsensitiveCompare(temp->bookCategory, category) &&
-        !temp->returned) {
-        return true;
+void removeQueryTerms(Book* book) {
+    if (!queryIndexReady) {
+        return;
+    }
+    auto byAuthor = authorIndex.find(book->author);
+    if (byAuthor != authorIndex.end()) {
+        eraseBook(byAuthor->second, book);
+        if (byAuthor->second.empty()) {
+            authorIndex.erase(byAuthor);
+        }
+    }
+    auto byYear = yearIndex.find(book->year);
+    if (byYear != yearIndex.end()) {
+        eraseBook(byYear->second, book);
+        if (byYear->second.empty()) {
+            yearIndex.erase(byYear);
+        }
     }
-    temp = temp->next;
-}
-return false;
 }
 
-void borrowBook() {
-    string category = selectCategory();
-    if (category.empty()) {
-        cout << "Borrowing cancelled.\n";
-        return;
+void buildQueryIndex() {
+    queryIndexReady = true;
+    for (Book* temp = head; temp; temp = temp->next) {
+        addQueryTerms(temp);
     }
+}
 
-    displayBooksByCategory(category);
+void changeAuthor(Book* book, Symbol author) {
+    removeQueryTerms(book);
+    removeAuthorTerms(book->author);
+    book->author = author;
+    addAuthorTerms(book->author);
+    addQueryTerms(book);
+}
 
-    string title;
-    cout << "Enter the title of the book you want to borrow: ";
-    getline(cin, title);
+void changeYear(Book* book, int year) {
+    removeQueryTerms(book);
+    book->year = year;
+    addQueryTerms(book);
+}
 
-    Book* temp = head;
-    while (temp) {
-        if (caseInsensitiveCompare(temp->category, category) &&
-            caseInsensitiveCompare(temp->title, title)) {
-            displayBookDetails(temp);
+// A conjunction of optional conditions; NO_SYMBOL and the default year
+// bounds mean "any".
+struct BookQuery {
+    Symbol author;
+    Symbol category;
+    int fromYear;
+    int toYear;
+    bool availableOnly;
+};
 
-            if (temp->availableCopies <= 0) {
-                cout << "Sorry, no copies of this book are currently available.\n";
-                return;
-            }
+BookQuery anyBook() {
+    BookQuery query = {NO_SYMBOL, NO_SYMBOL, INT32_MIN, INT32_MAX, false};
+    return query;
+}
 
-            string borrowerName, borrowerId;
-            do {
-                cout << "Enter your full name (minimum 3 letters, no numbers): ";
-                getline(cin, borrowerName);
-            } while (!isValidInput(borrowerName, "^[a-zA-Z ]+$", 3));
-
-            do {
-                cout << "Enter your ID (minimum 3 characters, letters or numbers): ";
-                getline(cin, borrowerId);
-                if (borrowerId.length() < 3) {
-                    cout << "ID must be at least 3 characters long.\n";
-                }
-            } while (borrowerId.length() < 3);
+bool bookMatches(const Book* book, const BookQuery& query) {
+    return (query.author == NO_SYMBOL || book->author == query.author) &&
+           (query.category == NO_SYMBOL || book->category == query.category) &&
+           book->year >= query.fromYear && book->year <= query.toYear &&
+           (!query.availableOnly || book->availableCopies > 0);
+}
 
-            if (hasBorrowedSpecificBook(borrowerId, title, category)) {
-                cout << "Sorry, you have already borrowed a copy of this book.\n";
-                cout << "Please return it before borrowing another copy.\n";
-                return;
-            }
+enum QueryPlan {
+    PLAN_AUTHOR_INDEX,
+    PLAN_CATEGORY_CHAIN,
+    PLAN_YEAR_INDEX,
+    PLAN_COLUMN_SCAN
+};
 
-            displayBorrowRules();
-
-            char confirm;
-            cout << "Do you want to proceed with borrowing 1 copy of '" << title << "'? (y/n): ";
-            cin >> confirm;
-            cin.ignore();
-
-            if (tolower(confirm) == 'y') {
-                temp->availableCopies -= 1;
-                saveToFile();
-
-                string borrowDate = getCurrentDateTime();
-                string returnDate = calculateReturnDate(14);
-
-                addBorrowRecord(title, category, borrowerName, borrowerId,
-                              1, borrowDate, returnDate);
-
-                cout << "\n--------- Borrowing Confirmation -----------\n";
-                cout << " Book Title: " << title << "\n";
-                cout << " Category: " << category << "\n";
-                cout << " Borrower Name: " << borrowerName << "\n";
-                cout << " Borrower ID: " << borrowerId << "\n";
-                cout << " Copies Borrowed: 1\n";
-                cout << " Borrow Date: " << borrowDate << "\n";
-                cout << " Due Date: " << returnDate << "\n";
-                cout << "-------------------------------------\n";
-                cout << "Thank you for borrowing from our library!\n";
-            } else {
-                cout << "Borrowing cancelled.\n";
-            }
-            return;
-        }
-        temp = temp->next;
+string queryPlanName(QueryPlan plan) {
+    switch (plan) {
+        case PLAN_AUTHOR_INDEX: return "author index";
+        case PLAN_CATEGORY_CHAIN: return "category chain";
+        case PLAN_YEAR_INDEX: return "year index";
+        default: return "column scan";
     }
-    cout << "Book not found in category '" << category << "'.\n";
 }
 
-void returnBook() {
-    string category = selectCategory();
-    if (category.empty()) {
-        cout << "Returning cancelled.\n";
-        return;
+// Runs `query` starting from whichever source yields the fewest books: the
+// author's books, the category's chain, the year range, or (when nothing
+// narrows it) a scan of the catalogue columns. Every candidate is then
+// checked against the whole query. Results are in no particular order.
+vector<Book*> findBooks(const BookQuery& query, QueryPlan* planUsed = NULL) {
+    if (!queryIndexReady) {
+        buildQueryIndex();
     }
 
-    displayBooksByCategory(category);
-
-    string title;
-    cout << "Enter the title of the book you want to return: ";
-    getline(cin, title);
+    vector<Book*> results;
+    QueryPlan plan = PLAN_COLUMN_SCAN;
+    size_t cost = columns.owners.size();
 
-    string borrowerName, borrowerId;
-    do {
-        cout << "Enter your full name (minimum 3 letters, no numbers): ";
-        getline(cin, borrowerName);
-    } while (!isValidInput(borrowerName, "^[a-zA-Z ]+$", 3));
+    const vector<Book*>* authorBooks = NULL;
+    if (query.author != NO_SYMBOL) {
+        auto it = authorIndex.find(query.author);
+        if (it == authorIndex.end()) {
+            if (planUsed) *planUsed = PLAN_AUTHOR_INDEX;
+            return results;
+        }
+        authorBooks = &it->second;
+        plan = PLAN_AUTHOR_INDEX;
+        cost = authorBooks->size();
+    }
 
-    do {
-        cout << "Enter your ID (minimum 3 characters, letters or numbers): ";
-        getline(cin, borrowerId);
-        if (borrowerId.length() < 3) {
-            cout << "ID must be at least 3 characters long.\n";
+    Category* cat = NULL;
+    if (query.category != NO_SYMBOL) {
+        cat = findCategory(query.category);
+        if (!cat) {
+            if (planUsed) *planUsed = PLAN_CATEGORY_CHAIN;
+            return results;
         }
-    } while (borrowerId.length() < 3);
+        if ((size_t)cat->bookCount < cost) {
+            plan = PLAN_CATEGORY_CHAIN;
+            cost = cat->bookCount;
+        }
+    }
 
-    Book* book = head;
-    while (book) {
-        if (caseInsensitiveCompare(book->category, category) &&
-            caseInsensitiveCompare(book->title, title)) {
-            break;
+    map<int, vector<Book*> >::iterator yearsBegin = yearIndex.lower_bound(query.fromYear);
+    map<int, vector<Book*> >::iterator yearsEnd = yearIndex.upper_bound(query.toYear);
+    if (query.fromYear != INT32_MIN || query.toYear != INT32_MAX) {
+        size_t inRange = 0;
+        for (auto it = yearsBegin; it != yearsEnd && inRange < cost; ++it) {
+            inRange += it->second.size();
+        }
+        if (inRange < cost) {
+            plan = PLAN_YEAR_INDEX;
+            cost = inRange;
         }
-        book = book->next;
     }
 
+    if (plan == PLAN_AUTHOR_INDEX) {
+        for (size_t i = 0; i < authorBooks->size(); i++) {
+            if (bookMatches((*authorBooks)[i], query)) results.push_back((*authorBooks)[i]);
+        }
+    } else if (plan == PLAN_CATEGORY_CHAIN) {
+        for (Book* temp = cat->first; temp; temp = temp->categoryNext) {
+            if (bookMatches(temp, query)) results.push_back(temp);
+        }
+    } else if (plan == PLAN_YEAR_INDEX) {
+        for (auto it = yearsBegin; it != yearsEnd; ++it) {
+            for (size_t i = 0; i < it->second.size(); i++) {
+                if (bookMatches(it->second[i], query)) results.push_back(it->second[i]);
+            }
+        }
+    } else {
+        const int* year = columns.year.data();
+        const int* available = columns.availableCopies.data();
+        const Symbol* category = columns.category.data();
+        for (size_t i = 0; i < columns.owners.size(); i++) {
+            if ((query.category == NO_SYMBOL || category[i] == query.category) &&
+                year[i] >= query.fromYear && year[i] <= query.toYear &&
+                (!query.availableOnly || available[i] > 0)) {
+                results.push_back(columns.owners[i]);
+            }
+        }
+    }
+
+    if (planUsed) *planUsed = plan;
+    return results;
+}
+
+// The search indexes are built on first use. Readers only hold the lock
+// shared, so build any missing ones under the exclusive lock beforehand.
+void prepareSearchIndexes() {
+    {
+        ReadLock lock(libraryLock);
+        if (titleSearchReady && authorSearchReady && queryIndexReady) {
+            return;
+        }
+    }
+    WriteLock lock(libraryLock);
+    if (!titleSearchReady) {
+        buildTitleSearch();
+    }
+    if (!authorSearchReady) {
+        buildAuthorSearch();
+    }
+    if (!queryIndexReady) {
+        buildQueryIndex();
+    }
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+enum InputCheck {
+    INPUT_OK,
+    INPUT_TOO_SHORT,
+    INPUT_BAD_CHARACTER
+};
+
+// Matches ^[a-zA-Z ]+$ with at least minLength characters. Does no I/O, so
+// batch imports can call it directly.
+InputCheck checkLettersAndSpaces(const string& input, size_t minLength) {
+    if (input.length() < minLength) {
+        return INPUT_TOO_SHORT;
+    }
+    for (size_t i = 0; i < input.length(); i++) {
+        if (!isAlpha(input[i]) && input[i] != ' ') {
+            return INPUT_BAD_CHARACTER;
+        }
+    }
+    return INPUT_OK;
+}
+
+// Interactive wrapper around checkLettersAndSpaces that explains failures.
+bool isValidInput(const string& input, int minLength) {
+    InputCheck check = checkLettersAndSpaces(input, minLength);
+    if (check == INPUT_TOO_SHORT) {
+        cout << " Input must be at least " << minLength << " characters long.\n";
+    } else if (check == INPUT_BAD_CHARACTER) {
+        cout << " Invalid input format. Only letters and spaces allowed.\n";
+    }
+    return check == INPUT_OK;
+}
+
+// Like getSafeInt, but a blank answer (or the end of input) returns false.
+bool getOptionalInt(int& result, const string& prompt, int min, int max) {
+    string input;
+    while (true) {
+        cout << prompt;
+        getline(cin, input);
+        if (input.empty()) {
+            return false;
+        }
+        bool isValid = input.size() <= 9;
+        for (char c : input) {
+            if (!isDigit(c)) {
+                isValid = false;
+                break;
+            }
+        }
+
+        if (!isValid) {
+            cout << " Invalid input. Please enter a valid number.\n";
+        } else {
+            result = stoi(input);
+            if (result >= min && result <= max) {
+                return true;
+            }
+            cout << " Please enter a number between " << min << " and " << max << ".\n";
+        }
+    }
+}
+
+// Asks until a number in [min, max] is entered. Returns false only if
+// input ends (EOF or a stream error); callers treat that as cancel or exit.
+bool getSafeInt(int& result, const string& prompt, int min, int max) {
+    string input;
+    while (true) {
+        cout << prompt;
+        if (!getline(cin, input)) {
+            return false;
+        }
+        bool isValid = !input.empty() && input.size() <= 9;
+        for (char c : input) {
+            if (!isDigit(c)) {
+                isValid = false;
+                break;
+            }
+        }
+
+        if (!isValid) {
+            cout << " Invalid input. Please enter a valid number.\n";
+        } else {
+            result = stoi(input);
+            if (result >= min && result <= max) {
+                return true;
+            } else {
+                cout << " Please enter a number between " << min << " and " << max << ".\n";
+            }
+        }
+    }
+}
+
+// ctime_r/ctime_s rather than ctime(), whose shared buffer is not safe
+// with several readers formatting dates at once.
+string formatDateTime(time_t when) {
+    char buffer[32] = "";
+#ifdef _WIN32
+    ctime_s(buffer, sizeof(buffer), &when);
+#else
+    ctime_r(&when, buffer);
+#endif
+    string dt = buffer;
+    return dt.substr(0, dt.length()-1);
+}
+
+string getCurrentDateTime() {
+    return formatDateTime(time(0));
+}
+
+time_t calculateReturnDate(int days = 14) {
+    return time(0) + days * 24 * 60 * 60;
+}
+
+// Parses a legacy ctime() string such as "Sat Oct 17 10:00:00 2026".
+// Only used to migrate data files written before dates were stored as
+// epoch seconds; returns 0 if the string is not in that format.
+time_t stringToTime(const string& dateStr) {
+    char day[4], month[4];
+    int dayNum, hour, minute, second, year;
+    if (sscanf(dateStr.c_str(), "%3s %3s %d %d:%d:%d %d",
+               day, month, &dayNum, &hour, &minute, &second, &year) != 7) {
+        return 0;
+    }
+
+    const char* months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+    int monthNum = 0;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(month, months[i]) == 0) {
+            monthNum = i;
+            break;
+        }
+    }
+
+    struct tm tm = {0};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = monthNum;
+    tm.tm_mday = dayNum;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1;
+
+    return mktime(&tm);
+}
+
+// Dates are stored as epoch seconds; older files hold ctime() strings.
+time_t parseStoredDate(const char* begin, const char* end) {
+    if (begin == end) {
+        return 0;
+    }
+    time_t value = 0;
+    for (const char* c = begin; c != end; ++c) {
+        if (*c < '0' || *c > '9') {
+            return stringToTime(string(begin, end));
+        }
+        value = value * 10 + (*c - '0');
+    }
+    return value;
+}
+
+time_t parseStoredDate(const string& field) {
+    return parseStoredDate(field.data(), field.data() + field.size());
+}
+
+int daysBetweenDates(time_t date1, time_t date2) {
+    return difftime(date2, date1) / (60 * 60 * 24);
+}
+
+const int FINE_PER_DAY = 5;
+
+int calculateFine(int daysLate) {
+    return daysLate > 0 ? daysLate * FINE_PER_DAY : 0;
+}
+
+void displayBookDetails(Book* book) {
+    cout << "\n--- Book Details ---\n";
+    cout << " Title: " << book->title << "\n";
+    cout << " Author: " << symbolName(book->author) << "\n";
+    cout << " Year: " << book->year << "\n";
+    cout << " Category: " << symbolName(book->category) << "\n";
+    cout << " Added on: " << formatDateTime(book->addedDate) << "\n";
+    cout << " Total copies: " << book->totalCopies << "\n";
+    cout << " Available copies: " << book->availableCopies << "\n";
+    float percentage = (book->totalCopies > 0) ? ((float)book->availableCopies / book->totalCopies * 100) : 0;
+    cout << " Status: " << percentage << "% available\n";
+    cout << "----------------------------------\n";
+}
+
+// Listings are formatted into one reusable buffer that is written out in
+// LISTING_FLUSH_BYTES chunks, instead of one stream write per field.
+const size_t LISTING_FLUSH_BYTES = 1 << 16;
+const int LISTING_PAGE_SIZE = 20;
+
+void appendNumber(string& out, long long value) {
+    char digits[24];
+    int length = 0;
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : value;
+    do {
+        digits[length++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        out += '-';
+    }
+    while (length > 0) {
+        out += digits[--length];
+    }
+}
+
+// Number of books a listing of `category` (NO_SYMBOL for all) covers.
+size_t listingSize(Symbol category) {
+    size_t total = 0;
+    for (size_t i = 0; i < categories.size(); i++) {
+        if (category == NO_SYMBOL || categories[i]->symbol == category) {
+            total += categories[i]->bookCount;
+        }
+    }
+    return total;
+}
+
+// Walks the category chains once, in registry order, writing the books of
+// `category` (NO_SYMBOL for all) after skipping the first `offset`, and at
+// most `limit` of them (0 for no limit). Whole categories before the offset
+// are skipped by their book count. Returns the number of books written.
+size_t writeCatalogueListing(ostream& out, Symbol category, size_t offset, size_t limit) {
+    static thread_local string buffer;
+    buffer.clear();
+    buffer.reserve(LISTING_FLUSH_BYTES + 1024);
+    time_t lastDate = 0;
+    string lastDateText;
+    size_t written = 0;
+
+    for (size_t c = 0; c < categories.size() && (limit == 0 || written < limit); c++) {
+        Category* cat = categories[c];
+        if (category != NO_SYMBOL && cat->symbol != category) {
+            continue;
+        }
+        if (offset >= (size_t)cat->bookCount) {
+            offset -= cat->bookCount;
+            continue;
+        }
+        Book* book = cat->first;
+        for (; offset > 0; offset--) {
+            book = book->categoryNext;
+        }
+
+        buffer += "\n--- Books in Category: ";
+        buffer += symbolName(cat->symbol);
+        buffer += " ---\n";
+        for (; book && (limit == 0 || written < limit); book = book->categoryNext) {
+            if (written == 0 || book->addedDate != lastDate) {
+                lastDate = book->addedDate;
+                lastDateText = formatDateTime(lastDate);
+            }
+            buffer += " Title: ";
+            buffer += book->title;
+            buffer += "\n Author: ";
+            buffer += symbolName(book->author);
+            buffer += "\n Year: ";
+            appendNumber(buffer, book->year);
+            buffer += "\n Added on: ";
+            buffer += lastDateText;
+            buffer += "\n Copies: ";
+            appendNumber(buffer, book->availableCopies);
+            buffer += '/';
+            appendNumber(buffer, book->totalCopies);
+            buffer += " available\n-------------------------\n";
+            written++;
+            if (buffer.size() >= LISTING_FLUSH_BYTES) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+    return written;
+}
+
+void displayBooksByCategory(const string& category) {
+    Category* cat = findCategory(category);
+    if (!cat) {
+        cout << "\n--- Books in Category: " << category << " ---\n";
+        cout << " No books found in this category.\n";
+        return;
+    }
+    writeCatalogueListing(cout, cat->symbol, 0, 0);
+}
+
+void displayAllBooks() {
+    if (!head) {
+        cout << "No books in the library.\n";
+        return;
+    }
+    writeCatalogueListing(cout, NO_SYMBOL, 0, 0);
+}
+
+// Shows a listing a page at a time: Enter moves on, p goes back, a number
+// jumps to that page and q stops. Each page is written under the shared
+// lock, which is released while waiting for the reader's answer.
+// What an empty listing says: the category chosen, or the whole library.
+void printEmptyListing(const string& categoryName) {
+    if (categoryName.empty()) {
+        cout << "No books in the library.\n";
+    } else {
+        cout << "No books in category '" << categoryName << "'.\n";
+    }
+}
+
+void pageCatalogueListing(const string& categoryName) {
+    Symbol category = NO_SYMBOL;
+    size_t total;
+    {
+        ReadLock lock(libraryLock);
+        if (!categoryName.empty()) {
+            category = findSymbol(categoryName);
+        }
+        total = category == NO_SYMBOL && !categoryName.empty() ? 0 : listingSize(category);
+    }
+    if (total == 0) {
+        printEmptyListing(categoryName);
+        return;
+    }
+    int pageSize = LISTING_PAGE_SIZE;
+    if (!getOptionalInt(pageSize, "Books per page (1-500, blank for " + to_string(LISTING_PAGE_SIZE) + "): ", 1, 500)) {
+        pageSize = LISTING_PAGE_SIZE;
+    }
+
+    size_t pages;
+    size_t page = 0;
+    while (true) {
+        {
+            ReadLock lock(libraryLock);
+            total = listingSize(category);
+            if (total == 0) {
+                printEmptyListing(categoryName);
+                return;
+            }
+            pages = (total + pageSize - 1) / pageSize;
+            page = min(page, pages - 1);
+            writeCatalogueListing(cout, category, page * pageSize, pageSize);
+        }
+        cout << "Page " << page + 1 << " of " << pages << " (" << total << " books). "
+             << "Enter for next, p for previous, a page number, or q to stop: ";
+        string answer;
+        if (!getline(cin, answer) || answer == "q" || answer == "Q") {
+            return;
+        }
+        if (answer.empty()) {
+            if (page + 1 == pages) {
+                return;
+            }
+            page++;
+        } else if (answer == "p" || answer == "P") {
+            if (page > 0) {
+                page--;
+            }
+        } else {
+            bool isNumber = answer.size() <= 9;
+            for (char c : answer) {
+                isNumber = isNumber && isDigit(c);
+            }
+            int target = isNumber ? stoi(answer) : 0;
+            if (target >= 1 && (size_t)target <= pages) {
+                page = target - 1;
+            } else {
+                cout << " Please enter a page between 1 and " << pages << ".\n";
+            }
+        }
+    }
+}
+
+// Writes the full listing to `path`; returns false if the file could not
+// be written.
+bool exportCatalogue(const string& path, size_t& written) {
+    ofstream out(path.c_str(), ios::binary);
+    if (!out) {
+        return false;
+    }
+    written = writeCatalogueListing(out, NO_SYMBOL, 0, 0);
+    out.close();
+    return !out.fail();
+}
+
+void exportCatalogueMenu() {
+    string path;
+    cout << "Enter the file to export the catalogue to: ";
+    getline(cin, path);
+    if (path.empty()) {
+        cout << "Export cancelled.\n";
+        return;
+    }
+    size_t written = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool exported;
+    {
+        ReadLock lock(libraryLock);
+        exported = exportCatalogue(path, written);
+    }
+    if (!exported) {
+        cout << " Error: could not write " << path << ".\n";
+        return;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Exported " << written << " books to " << path << " in " << ms << " ms.\n";
+}
+
+int countCategories() {
+    return categories.size();
+}
+
+vector<string> categoryNames() {
+    vector<string> names;
+    for (size_t i = 0; i < categories.size(); i++) {
+        names.push_back(symbolName(categories[i]->symbol));
+    }
+    return names;
+}
+
+void showCategoryMenu(const vector<string>& names) {
+    cout << "\n--------- Book Categories ----------\n";
+    int index = 1;
+
+    for (size_t i = 0; i < names.size(); i++) {
+        cout << index++ << ". " << names[i] << "\n";
+    }
+
+    cout << index << ". Back to Main Menu\n";
+}
+
+// Prompts for one of `names`; returns "" for Back or at the end of input.
+string selectCategory(const vector<string>& names) {
+    int totalCategories = names.size();
+    int choice;
+    int totalOptions = totalCategories + 1;
+
+    while (true) {
+        showCategoryMenu(names);
+        if (!getSafeInt(choice, "Select category (or " + to_string(totalCategories+1) + " to exit): ", 1, totalOptions)) {
+            return "";
+        }
+
+        if (choice <= totalCategories) {
+            return names[choice - 1];
+        } else {
+            return "";
+        }
+    }
+}
+
+// Copies the category names under the shared lock and prompts without it,
+// so callers must not hold libraryLock. The category may be gone by the
+// time the caller uses it; every caller looks it up again under the lock.
+string selectCategory() {
+    vector<string> names;
+    {
+        ReadLock lock(libraryLock);
+        names = categoryNames();
+    }
+    return selectCategory(names);
+}
+
+// The book with this title and author in any category, or NULL.
+Book* findBookAnyCategory(const string& title, const string& author) {
+    Symbol authorSymbol = findSymbol(author);
+    if (authorSymbol == NO_SYMBOL) {
+        return NULL;
+    }
+
+    FoldedTitle folded = foldTitle(title);
+    Book* temp = head;
+    while (temp) {
+        if (temp->author == authorSymbol && titleMatches(temp, folded)) {
+            return temp;
+        }
+        temp = temp->next;
+    }
+    return NULL;
+}
+
+bool bookExists(const string& title, const string& author) {
+    return findBookAnyCategory(title, author) != NULL;
+}
+
+Book* addBookToList(string title, const string& author, int year,
+                  const string& category, time_t addedDate,
+                  int totalCopies, int availableCopies) {
+    FoldedTitle folded = foldTitle(title);
+    Book* newBook = bookPool.create(Book{move(title), move(folded), intern(author), year, totalCopies, availableCopies,
+                                         intern(category), addedDate, NULL, NULL, NULL, NULL, 0, -1,
+                                         (int)booksBySerial.size()});
+    booksBySerial.push_back(newBook);
+    indexBook(newBook);
+    addTitleTerms(newBook);
+    addAuthorTerms(newBook->author);
+    addQueryTerms(newBook);
+    registerBook(newBook);
+    addBookColumns(newBook);
+    if (!head) {
+        head = newBook;
+    } else {
+        tail->next = newBook;
+        newBook->prev = tail;
+    }
+    tail = newBook;
+    return newBook;
+}
+
+// Title and author together identify a book (addBooks and updateBook keep
+// them unique), so this is how journal records find their target.
+Book* findExactBook(const string& category, const string& title, const string& author) {
+    Book* book = findBook(category, title);
+    Symbol authorSymbol = findSymbol(author);
+    if (!book || book->author == authorSymbol) {
+        return book;
+    }
+
+    FoldedTitle folded = foldTitle(title);
+    Category* cat = findCategory(category);
+    for (Book* temp = cat->first; temp; temp = temp->categoryNext) {
+        if (temp->author == authorSymbol && titleMatches(temp, folded)) {
+            return temp;
+        }
+    }
+    return NULL;
+}
+
+// Books removed from the catalogue while borrow records still point at
+// them. They stay allocated (off the list and indexes) until cleanup() so
+// loan history keeps its title and category.
+vector<Book*> retiredBooks;
+unordered_map<string, Book*> retiredBookIndex;
+
+void removeBook(Book* book) {
+    unindexBook(book);
+    removeTitleTerms(book);
+    removeAuthorTerms(book->author);
+    removeQueryTerms(book);
+    booksBySerial[book->serial] = NULL;
+    unregisterBook(book);
+    removeBookColumns(book);
+    if (book->prev)
+        book->prev->next = book->next;
+    else
+        head = book->next;
+
+    if (book->next)
+        book->next->prev = book->prev;
+    else
+        tail = book->prev;
+
+    if (book->loanCount > 0) {
+        book->prev = NULL;
+        book->next = NULL;
+        retiredBooks.push_back(book);
+        retiredBookIndex[makeBookKey(book->category, book->folded.text)] = book;
+        return;
+    }
+    bookPool.destroy(book);
+}
+
+// Removes every book at once. Books still on loan are retired exactly as
+// removeBook does; the search indexes are dropped whole and rebuild on the
+// next query instead of being unwound one book at a time.
+void clearCatalogue() {
+    for (Book* temp = head; temp; ) {
+        Book* next = temp->next;
+        temp->prev = NULL;
+        temp->next = NULL;
+        temp->categoryPrev = NULL;
+        temp->categoryNext = NULL;
+        temp->column = -1;
+        if (temp->loanCount > 0) {
+            retiredBooks.push_back(temp);
+            retiredBookIndex[makeBookKey(temp->category, temp->folded.text)] = temp;
+        } else {
+            bookPool.destroy(temp);
+        }
+        temp = next;
+    }
+    head = tail = NULL;
+
+    for (size_t i = 0; i < categories.size(); i++) {
+        delete categories[i];
+    }
+    categories.clear();
+    categoryIndex.clear();
+    bookIndex.clear();
+    columns = CatalogueColumns();
+    booksBySerial.clear();
+    titleOrder.clear();
+    titleTrigrams.clear();
+    wordTrigrams.clear();
+    titleSearchReady = false;
+    authorTrigrams.clear();
+    authorBookCounts.clear();
+    authorSearchReady = false;
+    authorIndex.clear();
+    yearIndex.clear();
+    queryIndexReady = false;
+}
+
+// Finds the book a borrow record refers to. Records for books that are no
+// longer in the catalogue get a retired placeholder carrying just the
+// title and category.
+Book* resolveLoanBook(const string& category, const string& title) {
+    Book* book = findBook(category, title);
+    if (book) {
+        return book;
+    }
+
+    Symbol categorySymbol = intern(category);
+    FoldedTitle folded = foldTitle(title);
+    string key = makeBookKey(categorySymbol, folded.text);
+    auto it = retiredBookIndex.find(key);
+    if (it != retiredBookIndex.end()) {
+        return it->second;
+    }
+
+    book = bookPool.create(Book{title, folded, NO_SYMBOL, 0, 0, 0, categorySymbol, 0,
+                                NULL, NULL, NULL, NULL, 0, -1, -1});
+    retiredBooks.push_back(book);
+    retiredBookIndex[key] = book;
+    return book;
+}
+
+enum SortField {
+    SORT_BY_TITLE = 1,
+    SORT_BY_AUTHOR,
+    SORT_BY_YEAR,
+    SORT_BY_ADDED_DATE
+};
+
+// One entry per book being sorted. Keys are computed once up front so the
+// merge never re-folds strings or reparses dates.
+struct SortNode {
+    string key;
+    long long number;
+    Book* book;
+    SortNode* next;
+};
+
+bool sortNodeLess(const SortNode* a, const SortNode* b, bool byNumber) {
+    return byNumber ? a->number < b->number : a->key < b->key;
+}
+
+SortNode* mergeSortNodes(SortNode* list, bool byNumber) {
+    if (!list || !list->next) {
+        return list;
+    }
+
+    SortNode* slow = list;
+    SortNode* fast = list->next;
+    while (fast && fast->next) {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    SortNode* right = slow->next;
+    slow->next = NULL;
+
+    SortNode* left = mergeSortNodes(list, byNumber);
+    right = mergeSortNodes(right, byNumber);
+
+    SortNode merged = {"", 0, NULL, NULL};
+    SortNode* last = &merged;
+    while (left && right) {
+        // Taking from the left on ties keeps the sort stable.
+        if (sortNodeLess(right, left, byNumber)) {
+            last->next = right;
+            right = right->next;
+        } else {
+            last->next = left;
+            left = left->next;
+        }
+        last = last->next;
+    }
+    last->next = left ? left : right;
+    return merged.next;
+}
+
+string sortFieldName(SortField field) {
+    switch (field) {
+        case SORT_BY_AUTHOR: return "author";
+        case SORT_BY_YEAR: return "year";
+        case SORT_BY_ADDED_DATE: return "date added";
+        default: return "title";
+    }
+}
+
+void saveToFile();
+
+void sortBooksInCategory(const string& category, SortField field) {
+    Category* cat = findCategory(category);
+    if (!cat || cat->bookCount < 2) {
+        cout << " Not enough books to sort.\n";
+        return;
+    }
+
+    bool byNumber = field == SORT_BY_YEAR || field == SORT_BY_ADDED_DATE;
+    vector<SortNode> nodes;
+    nodes.reserve(cat->bookCount);
+    for (Book* temp = cat->first; temp; temp = temp->categoryNext) {
+        SortNode node = {"", 0, temp, NULL};
+        if (field == SORT_BY_AUTHOR)
+            node.key = foldCase(symbolName(temp->author));
+        else if (field == SORT_BY_YEAR)
+            node.number = temp->year;
+        else if (field == SORT_BY_ADDED_DATE)
+            node.number = temp->addedDate;
+        else
+            node.key = temp->folded.text;
+        nodes.push_back(node);
+    }
+    for (size_t i = 0; i + 1 < nodes.size(); i++) {
+        nodes[i].next = &nodes[i + 1];
+    }
+
+    SortNode* sorted = mergeSortNodes(&nodes[0], byNumber);
+
+    // Detach the category's books from the main list, remembering the node
+    // that preceded the first of them; the sorted run is spliced back there.
+    Book* anchor = cat->first->prev;
+    for (Book* temp = cat->first; temp; temp = temp->categoryNext) {
+        if (temp == anchor)
+            anchor = temp->prev;
+
+        if (temp->prev)
+            temp->prev->next = temp->next;
+        else
+            head = temp->next;
+
+        if (temp->next)
+            temp->next->prev = temp->prev;
+        else
+            tail = temp->prev;
+    }
+
+    Book* after = anchor ? anchor->next : head;
+    Book* previous = anchor;
+    Book* categoryPrevious = NULL;
+    for (SortNode* node = sorted; node; node = node->next) {
+        Book* book = node->book;
+        book->prev = previous;
+        if (previous)
+            previous->next = book;
+        else
+            head = book;
+
+        book->categoryPrev = categoryPrevious;
+        if (categoryPrevious)
+            categoryPrevious->categoryNext = book;
+        else
+            cat->first = book;
+
+        previous = book;
+        categoryPrevious = book;
+    }
+    previous->next = after;
+    if (after)
+        after->prev = previous;
+    else
+        tail = previous;
+    categoryPrevious->categoryNext = NULL;
+    cat->last = categoryPrevious;
+
+    saveToFile();
+    cout << "\nBooks in category '" << category << "' sorted by " << sortFieldName(field) << ":\n";
+    displayBooksByCategory(category);
+}
+
+void sortBooksMenu() {
+    string category = selectCategory();
+    if (category.empty()) {
+        cout << "Sorting cancelled.\n";
+        return;
+    }
+
+    int choice;
+    cout << "\n---------- Sort Options -----------\n";
+    cout << "1. Sort by Title\n";
+    cout << "2. Sort by Author\n";
+    cout << "3. Sort by Year\n";
+    cout << "4. Sort by Date Added\n";
+    if (!getSafeInt(choice, "Enter your choice (1-4): ", 1, 4)) return;
+
+    WriteLock lock(libraryLock);
+    sortBooksInCategory(category, (SortField)choice);
+}
+
+void displayBooksMenu() {
+    int choice;
+    do {
+        cout << "\n---------- Display Options -----------\n";
+        cout << "1. Display All Books\n";
+        cout << "2. Display Books by Category\n";
+        cout << "3. Export Catalogue to File\n";
+        cout << "4. Back to Main Menu\n";
+
+        if (!getSafeInt(choice, "Enter your choice (1-4): ", 1, 4)) return;
+
+        switch (choice) {
+            case 1:
+                pageCatalogueListing("");
+                break;
+            case 2: {
+                string category = selectCategory();
+                if (!category.empty()) {
+                    pageCatalogueListing(category);
+                }
+                break;
+            }
+            case 3:
+                exportCatalogueMenu();
+                break;
+            case 4:
+                return;
+        }
+    } while (true);
+}
+
+// Mutations are appended to one journal, book and borrow records alike,
+// instead of rewriting the snapshots; a change that touches both (a loan
+// and the copy it takes) therefore reaches the disk in one file. Snapshots
+// and the journal start with a "#generation|N" line; each snapshot replays
+// only a journal of its own generation, so a compaction that crashed before
+// resetting the journal never applies it twice. Lines of a group are
+// wrapped in "B" and "C" lines and replayed only if the "C" made it to disk.
+const string LIBRARY_FILE = "library_data.txt";
+const string LIBRARY_JOURNAL = "library_journal.txt";
+const string BORROW_FILE = "borrow_records.txt";
+// Older versions kept borrow changes in a journal of their own; it is
+// replayed once and folded into the snapshots at startup.
+const string LEGACY_BORROW_JOURNAL = "borrow_journal.txt";
+const int JOURNAL_COMPACT_THRESHOLD = 1000;
+
+struct Journal {
+    string path;
+    FILE* file;
+    long generation;
+    int entries;
+    string pending;
+    string staged;
+};
+
+Journal libraryJournal = {LIBRARY_JOURNAL, NULL, 0, 0, "", ""};
+
+// Group commit. While the journal writer thread runs, appendJournal() only
+// queues the line in Journal::pending and numbers it. The writer waits
+// GROUP_COMMIT_WINDOW_MS after the first queued line so changes from other
+// terminals can join it, then writes everything queued with one write and
+// one fsync; waitForJournals() blocks until that has happened.
+// Without the writer (imports, conversions) appends are fsynced inline.
+// Lock order: journalFileMutex (FILE handles), then journalQueueMutex
+// (pending lines, sequence numbers, stats).
+const int GROUP_COMMIT_WINDOW_MS = 2;
+
+struct GroupCommitStats {
+    long flushes;
+    long changes;
+    long largestBatch;
+    double totalFlushMs;
+    double slowestFlushMs;
+};
+
+thread journalWriter;
+bool journalWriterRunning = false;
+bool journalWriterStopping = false;
+mutex journalFileMutex;
+mutex journalQueueMutex;
+condition_variable journalQueued;
+condition_variable journalFlushed;
+long journalQueuedSequence = 0;
+long journalDurableSequence = 0;
+GroupCommitStats groupCommitStats = {0, 0, 0, 0, 0};
+
+// Changes made between beginJournalGroup() and commitJournalGroup() are
+// staged and handed to the writer (or written and fsynced) together between
+// "B" and "C" lines, so replay applies all of them or none. Compaction is
+// put off until the group commits, so a snapshot never holds half a group.
+// Used under the exclusive library lock.
+int journalGroupDepth = 0;
+// Set when a compaction is asked for inside a group (or before the journal
+// is opened); it runs once the group commits.
+bool journalCompactionDue = false;
+
+bool syncFile(FILE* file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Renames a written and fsynced temp file over `path`. On POSIX systems the
+// directory is fsynced as well, so the rename itself survives a crash.
+bool replaceFile(const string& tempPath, const string& path) {
+#ifdef _WIN32
+    remove(path.c_str());
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+#else
+    if (rename(tempPath.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : path.substr(0, slash + 1);
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+#endif
+}
+
+// Only one process may own the data files at a time: the journals are
+// appended through buffered handles and compaction renames snapshots in
+// place, neither of which is safe against a second writer. Every entry
+// point that loads the library takes this lock first; the operating system
+// drops it when the process exits, even after a crash.
+const string LIBRARY_LOCK_FILE = "library.lock";
+
+bool lockDataDirectory() {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(LIBRARY_LOCK_FILE.c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    OVERLAPPED region = {};
+    bool locked = file != INVALID_HANDLE_VALUE &&
+                  LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &region);
+    bool busy = !locked && GetLastError() == ERROR_LOCK_VIOLATION;
+    if (!locked && file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+#else
+    int file = open(LIBRARY_LOCK_FILE.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    bool locked = file >= 0 && flock(file, LOCK_EX | LOCK_NB) == 0;
+    bool busy = !locked && errno == EWOULDBLOCK;
+    if (!locked && file >= 0) {
+        close(file);
+    }
+#endif
+    if (busy) {
+        cout << " Error: another library session is already using this directory.\n";
+    } else if (!locked) {
+        cout << " Error: could not lock " << LIBRARY_LOCK_FILE << ".\n";
+    }
+    // The handle stays open for the life of the process to keep the lock.
+    return locked;
+}
+
+vector<string> splitFields(const string& line) {
+    vector<string> fields;
+    size_t start = 0;
+    size_t pos;
+    while ((pos = line.find('|', start)) != string::npos) {
+        fields.push_back(line.substr(start, pos - start));
+        start = pos + 1;
+    }
+    fields.push_back(line.substr(start));
+    return fields;
+}
+
+long parseGeneration(const string& line) {
+    if (line.compare(0, 12, "#generation|") != 0) {
+        return -1;
+    }
+    return atol(line.c_str() + 12);
+}
+
+// Lines still queued for the old journal are dropped: the snapshot that
+// was just written already contains their changes.
+void resetJournal(Journal& journal, long generation) {
+    lock_guard<mutex> fileLock(journalFileMutex);
+    {
+        lock_guard<mutex> lock(journalQueueMutex);
+        journal.pending.clear();
+    }
+    journal.staged.clear();
+    if (journal.file) {
+        fclose(journal.file);
+    }
+    journal.generation = generation;
+    journal.entries = 0;
+    journal.file = fopen(journal.path.c_str(), "w");
+    if (!journal.file) {
+        cout << " Warning: could not open " << journal.path << " for writing.\n";
+        return;
+    }
+    fprintf(journal.file, "#generation|%ld\n", generation);
+    syncFile(journal.file);
+}
+
+void openJournal(Journal& journal, long generation, int replayedEntries) {
+    if (replayedEntries < 0) {
+        resetJournal(journal, generation);
+        return;
+    }
+    journal.generation = generation;
+    journal.entries = replayedEntries;
+    journal.file = fopen(journal.path.c_str(), "a");
+    if (!journal.file) {
+        cout << " Warning: could not open " << journal.path << " for writing.\n";
+    }
+}
+
+// Reads the journal body if its generation matches the snapshot. Returns
+// the lines to replay through `records`, or -1 if the journal is missing or
+// stale and has to be started over. A group cut short by a crash (a "B"
+// line with no "C") is dropped whole.
+int readJournal(const string& path, long generation, vector<string>& records) {
+    ifstream file(path.c_str());
+    string line;
+    if (!getline(file, line) || parseGeneration(line) != generation) {
+        return -1;
+    }
+    size_t groupStart = 0;
+    bool inGroup = false;
+    while (getline(file, line)) {
+        if (line == "B") {
+            if (inGroup) {
+                records.resize(groupStart);
+            }
+            groupStart = records.size();
+            inGroup = true;
+        } else if (line == "C") {
+            inGroup = false;
+        } else if (!line.empty()) {
+            records.push_back(line);
+        }
+    }
+    if (inGroup) {
+        records.resize(groupStart);
+    }
+    return records.size();
+}
+
+// Returns true once the journal is long enough that the caller should
+// compact it into a fresh snapshot.
+bool appendJournal(Journal& journal, const string& record) {
+    if (!journal.file) {
+        return false;
+    }
+    if (journalGroupDepth > 0) {
+        journal.staged += record;
+        journal.staged += '\n';
+        journal.entries++;
+        return false;
+    } else if (journalWriterRunning) {
+        lock_guard<mutex> lock(journalQueueMutex);
+        journal.pending += record;
+        journal.pending += '\n';
+        journalQueuedSequence++;
+        journalQueued.notify_one();
+    } else {
+        string line = record + "\n";
+        fwrite(line.data(), 1, line.size(), journal.file);
+        if (!syncFile(journal.file)) {
+            cout << " Warning: could not flush " << journal.path << ".\n";
+        }
+    }
+    return ++journal.entries >= JOURNAL_COMPACT_THRESHOLD;
+}
+
+void writeJournalLines(Journal& journal, const string& lines) {
+    if (lines.empty() || !journal.file) {
+        return;
+    }
+    if (fwrite(lines.data(), 1, lines.size(), journal.file) != lines.size() || !syncFile(journal.file)) {
+        cout << " Warning: could not flush " << journal.path << ".\n";
+    }
+}
+
+void beginJournalGroup() {
+    journalGroupDepth++;
+}
+
+void commitJournalGroup() {
+    Journal& journal = libraryJournal;
+    if (--journalGroupDepth > 0 || journal.staged.empty()) {
+        return;
+    }
+    string lines = "B\n" + journal.staged + "C\n";
+    if (journalWriterRunning) {
+        // The sequence counts changes, not groups, so the batch statistics
+        // see every staged line.
+        lock_guard<mutex> lock(journalQueueMutex);
+        journalQueuedSequence += count(journal.staged.begin(), journal.staged.end(), '\n');
+        journal.pending += lines;
+        journalQueued.notify_one();
+    } else {
+        writeJournalLines(journal, lines);
+    }
+    journal.staged.clear();
+    if (journal.entries >= JOURNAL_COMPACT_THRESHOLD || journalCompactionDue) {
+        saveToFile();
+    }
+}
+
+void runJournalWriter() {
+    unique_lock<mutex> lock(journalQueueMutex);
+    while (true) {
+        journalQueued.wait(lock, []() {
+            return journalQueuedSequence > journalDurableSequence || journalWriterStopping;
+        });
+        if (journalQueuedSequence == journalDurableSequence) {
+            break;
+        }
+        if (!journalWriterStopping) {
+            lock.unlock();
+            this_thread::sleep_for(chrono::milliseconds(GROUP_COMMIT_WINDOW_MS));
+            lock.lock();
+        }
+
+        lock.unlock();
+        unique_lock<mutex> fileLock(journalFileMutex);
+        lock.lock();
+        long batchEnd = journalQueuedSequence;
+        string lines;
+        lines.swap(libraryJournal.pending);
+        lock.unlock();
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        writeJournalLines(libraryJournal, lines);
+        double flushMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        fileLock.unlock();
+
+        lock.lock();
+        long batch = batchEnd - journalDurableSequence;
+        journalDurableSequence = batchEnd;
+        groupCommitStats.flushes++;
+        groupCommitStats.changes += batch;
+        groupCommitStats.largestBatch = max(groupCommitStats.largestBatch, batch);
+        groupCommitStats.totalFlushMs += flushMs;
+        groupCommitStats.slowestFlushMs = max(groupCommitStats.slowestFlushMs, flushMs);
+        journalFlushed.notify_all();
+    }
+}
+
+void startJournalWriter() {
+    journalWriterStopping = false;
+    journalWriterRunning = true;
+    journalWriter = thread(runJournalWriter);
+}
+
+// Flushes whatever is still queued and stops the writer.
+void stopJournalWriter() {
+    if (!journalWriterRunning) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(journalQueueMutex);
+        journalWriterStopping = true;
+        journalQueued.notify_one();
+    }
+    journalWriter.join();
+    journalWriterRunning = false;
+}
+
+// Blocks until every change queued so far is on disk. Call it after
+// releasing the library lock and before confirming a change.
+void waitForJournals() {
+    unique_lock<mutex> lock(journalQueueMutex);
+    long target = journalQueuedSequence;
+    journalFlushed.wait(lock, [target]() { return journalDurableSequence >= target; });
+}
+
+GroupCommitStats readGroupCommitStats() {
+    lock_guard<mutex> lock(journalQueueMutex);
+    return groupCommitStats;
+}
+
+string formatGroupCommitStats(const GroupCommitStats& stats) {
+    if (stats.flushes == 0) {
+        return "no journal flushes";
+    }
+    ostringstream out;
+    out << stats.flushes << " journal flushes for " << stats.changes << " changes (average batch "
+        << (double)stats.changes / stats.flushes << ", largest " << stats.largestBatch
+        << "), flush latency average " << stats.totalFlushMs / stats.flushes << " ms, slowest "
+        << stats.slowestFlushMs << " ms";
+    return out.str();
+}
+
+// Binary snapshots (library_data.bin, borrow_records.bin) are written next
+// to the text snapshots on every compaction and preferred at startup.
+// Layout, in host byte order:
+//   char magic[4] = "DULB", uint32 version, uint32 kind, int64 generation,
+//   uint32 stringCount, uint32 recordCount,
+//   stringCount x (uint32 length, bytes),
+//   recordCount fixed-width records (string fields are table indexes,
+//   dates are int64 epoch seconds),
+//   uint64 FNV-1a checksum of everything before it.
+const string LIBRARY_BINARY_FILE = "library_data.bin";
+const string BORROW_BINARY_FILE = "borrow_records.bin";
+const uint32_t BINARY_VERSION = 1;
+const uint32_t BINARY_KIND_BOOKS = 1;
+const uint32_t BINARY_KIND_BORROWS = 2;
+
+uint64_t checksumBytes(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+void appendValue(string& out, T value) {
+    out.append((const char*)&value, sizeof(value));
+}
+
+// Interns strings while records are encoded; categories, authors and
+// borrowers repeat heavily so each is stored once.
+struct BinaryStringTable {
+    unordered_map<string, uint32_t> ids;
+    vector<const string*> strings;
+
+    uint32_t intern(const string& str) {
+        auto it = ids.find(str);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        uint32_t id = strings.size();
+        strings.push_back(&ids.insert(make_pair(str, id)).first->first);
+        return id;
+    }
+};
+
+string encodeBinarySnapshot(uint32_t kind, long generation, uint32_t recordCount,
+                            const BinaryStringTable& table, const string& records) {
+    string out;
+    out.reserve(32 + records.size() + table.strings.size() * 24);
+    out.append("DULB", 4);
+    appendValue<uint32_t>(out, BINARY_VERSION);
+    appendValue<uint32_t>(out, kind);
+    appendValue<int64_t>(out, generation);
+    appendValue<uint32_t>(out, table.strings.size());
+    appendValue<uint32_t>(out, recordCount);
+    for (size_t i = 0; i < table.strings.size(); i++) {
+        appendValue<uint32_t>(out, table.strings[i]->size());
+        out.append(*table.strings[i]);
+    }
+    out.append(records);
+    appendValue<uint64_t>(out, checksumBytes(out.data(), out.size()));
+    return out;
+}
+
+bool writeFileContents(const string& path, const string& contents) {
+    string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    written = syncFile(file) && written;
+    written = fclose(file) == 0 && written;
+    return written && replaceFile(tempPath, path);
+}
+
+// Text snapshots start with "#generation|N|checksum|X", where X is the
+// FNV-1a checksum (16 hex digits) of every byte after that line. The whole
+// file is formatted in memory and written with one call.
+bool writeTextSnapshot(const string& path, long generation, const string& body) {
+    char header[80];
+    snprintf(header, sizeof(header), "#generation|%ld|checksum|%016llx\n", generation,
+             (unsigned long long)checksumBytes(body.data(), body.size()));
+    string contents;
+    contents.reserve(strlen(header) + body.size());
+    contents += header;
+    contents += body;
+    return writeFileContents(path, contents);
+}
+
+bool writeBookBinary(const string& path, long generation) {
+    BinaryStringTable table;
+    string records;
+    uint32_t count = 0;
+    for (Book* temp = head; temp; temp = temp->next) {
+        appendValue<uint32_t>(records, table.intern(temp->title));
+        appendValue<uint32_t>(records, table.intern(symbolName(temp->author)));
+        appendValue<uint32_t>(records, table.intern(symbolName(temp->category)));
+        appendValue<int32_t>(records, temp->year);
+        appendValue<int32_t>(records, temp->totalCopies);
+        appendValue<int32_t>(records, temp->availableCopies);
+        appendValue<int64_t>(records, temp->addedDate);
+        count++;
+    }
+    return writeFileContents(path, encodeBinarySnapshot(BINARY_KIND_BOOKS, generation, count, table, records));
+}
+
+string formatBookFields(Book* book) {
+    return book->title + "|" + symbolName(book->author) + "|" + to_string(book->year) + "|" +
+           to_string(book->totalCopies) + "|" + to_string(book->availableCopies) + "|" +
+           symbolName(book->category) + "|" + to_string((long long)book->addedDate);
+}
+
+bool writeBorrowSnapshot(long generation);
+
+// Compacts the journal: writes both snapshots under the next generation,
+// borrow records first, then starts an empty journal. A crash part way
+// leaves each snapshot either at the journal's generation, so it still
+// replays the journal, or at the new one, which ignores it. Asked for
+// inside a group, it waits for the group to commit.
+void saveToFile() {
+    if (journalGroupDepth > 0) {
+        journalCompactionDue = true;
+        return;
+    }
+    journalCompactionDue = false;
+    long generation = libraryJournal.generation + 1;
+    if (!writeBorrowSnapshot(generation)) {
+        return;
+    }
+    string body;
+    for (Book* temp = head; temp; temp = temp->next) {
+        body += formatBookFields(temp);
+        body += '\n';
+    }
+    if (!writeTextSnapshot(LIBRARY_FILE, generation, body)) {
+        cout << " Error: could not write " << LIBRARY_FILE << ".\n";
+        return;
+    }
+    if (!writeBookBinary(LIBRARY_BINARY_FILE, generation)) {
+        cout << " Warning: could not write " << LIBRARY_BINARY_FILE << ".\n";
+        remove(LIBRARY_BINARY_FILE.c_str());
+    }
+    resetJournal(libraryJournal, generation);
+}
+
+// Every change to a live book is journaled, so this is also where the
+// columnar copy catches up.
+void journalBook(const string& oldCategory, const string& oldTitle,
+                 const string& oldAuthor, Book* book) {
+    syncBookColumns(book);
+    bool compact = appendJournal(libraryJournal, "P|" + oldCategory + "|" + oldTitle + "|" +
+                                                 oldAuthor + "|" + formatBookFields(book));
+    // Loans follow the book in memory, but the borrow snapshot names it by
+    // title and category; compact so they still resolve after a restart.
+    if (book->loanCount > 0 &&
+        (oldTitle != book->title || !caseInsensitiveCompare(oldCategory, symbolName(book->category)))) {
+        compact = true;
+    }
+    if (compact) {
+        saveToFile();
+    }
+}
+
+void journalBook(Book* book) {
+    journalBook(symbolName(book->category), book->title, symbolName(book->author), book);
+}
+
+void journalBookDeletion(Book* book) {
+    if (appendJournal(libraryJournal, "D|" + symbolName(book->category) + "|" + book->title + "|" + symbolName(book->author))) {
+        saveToFile();
+    }
+}
+
+void replayBookJournal(const vector<string>& records) {
+    for (size_t r = 0; r < records.size(); r++) {
+        vector<string> tokens = splitFields(records[r]);
+        if (tokens[0] == "P" && tokens.size() == 11) {
+            int year = stoi(tokens[6]);
+            int totalCopies = stoi(tokens[7]);
+            int availableCopies = stoi(tokens[8]);
+            time_t addedDate = parseStoredDate(tokens[10]);
+            Book* book = findExactBook(tokens[1], tokens[2], tokens[3]);
+            if (!book) {
+                addBookToList(tokens[4], tokens[5], year, tokens[9], addedDate,
+                              totalCopies, availableCopies);
+                continue;
+            }
+            renameBook(book, tokens[4], intern(tokens[9]));
+            changeAuthor(book, intern(tokens[5]));
+            changeYear(book, year);
+            book->totalCopies = totalCopies;
+            book->availableCopies = availableCopies;
+            book->addedDate = addedDate;
+            syncBookColumns(book);
+        } else if (tokens[0] == "D" && tokens.size() == 4) {
+            Book* book = findExactBook(tokens[1], tokens[2], tokens[3]);
+            if (book) {
+                removeBook(book);
+            }
+        }
+    }
+}
+
+// Read-only view of a whole data file. On POSIX the file is mmapped so the
+// loaders parse straight out of the page cache; elsewhere it is read into
+// one buffer.
+struct FileView {
+    const char* data;
+    size_t size;
+    vector<char> buffer;
+};
+
+bool openFileView(const string& path, FileView& view) {
+    view.data = NULL;
+    view.size = 0;
+#ifdef _WIN32
+    ifstream file(path.c_str(), ios::binary);
+    if (!file) {
+        return false;
+    }
+    view.buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    view.data = view.buffer.empty() ? NULL : &view.buffer[0];
+    view.size = view.buffer.size();
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    if (info.st_size > 0) {
+        void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+        view.data = (const char*)mapped;
+        view.size = info.st_size;
+    }
+    close(fd);
+    return true;
+#endif
+}
+
+void closeFileView(FileView& view) {
+#ifndef _WIN32
+    if (view.data) {
+        munmap((void*)view.data, view.size);
+    }
+#endif
+    view.data = NULL;
+    view.size = 0;
+    view.buffer.clear();
+}
+
+struct FieldSpan {
+    const char* begin;
+    const char* end;
+};
+
+// Splits [begin, end) on '|' into at most maxFields spans; the last span
+// takes the rest of the line. Returns the number of separators found.
+int splitFieldSpans(const char* begin, const char* end, FieldSpan fields[], int maxFields) {
+    int count = 0;
+    while (count < maxFields - 1) {
+        const char* bar = (const char*)memchr(begin, '|', end - begin);
+        if (!bar) {
+            break;
+        }
+        fields[count].begin = begin;
+        fields[count].end = bar;
+        count++;
+        begin = bar + 1;
+    }
+    fields[count].begin = begin;
+    fields[count].end = end;
+    return count;
+}
+
+// Parses a non-negative decimal field in place. Rejects anything but
+// digits, and values above INT_MAX rather than letting them wrap.
+bool parseIntField(const FieldSpan& field, int& value) {
+    if (field.begin == field.end) {
+        return false;
+    }
+    value = 0;
+    for (const char* c = field.begin; c != field.end; ++c) {
+        if (!isDigit(*c)) {
+            return false;
+        }
+        int digit = *c - '0';
+        if (value > (INT_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+string fieldString(const FieldSpan& field) {
+    return string(field.begin, field.end);
+}
+
+// Calls handleLine(begin, end) for every line of the view and returns the
+// generation from a leading "#generation|N" line (0 if there is none).
+template <typename LineHandler>
+long scanDataLines(const FileView& view, LineHandler handleLine) {
+    long generation = 0;
+    const char* pos = view.data;
+    const char* end = view.data + view.size;
+    while (pos < end) {
+        const char* lineEnd = (const char*)memchr(pos, '\n', end - pos);
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        if (*pos == '#') {
+            long lineGeneration = parseGeneration(string(pos, lineEnd));
+            if (lineGeneration >= 0) generation = lineGeneration;
+        } else {
+            handleLine(pos, lineEnd);
+        }
+        pos = lineEnd + 1;
+    }
+    return generation;
+}
+
+struct BookLineLoader {
+    void operator()(const char* begin, const char* end) const {
+        FieldSpan fields[7];
+        int year, totalCopies, availableCopies;
+        if (splitFieldSpans(begin, end, fields, 7) >= 6 &&
+            parseIntField(fields[2], year) &&
+            parseIntField(fields[3], totalCopies) &&
+            parseIntField(fields[4], availableCopies)) {
+            addBookToList(fieldString(fields[0]), fieldString(fields[1]), year,
+                          fieldString(fields[5]), parseStoredDate(fields[6].begin, fields[6].end),
+                          totalCopies, availableCopies);
+        }
+    }
+};
+
+enum SnapshotCheck {
+    SNAPSHOT_OK,
+    SNAPSHOT_MISSING,
+    SNAPSHOT_DAMAGED
+};
+
+// Verifies the checksum in a text snapshot's header. Snapshots are never
+// written without a header line, so a headered file cut off before its
+// newline, or failing its checksum, is damaged. Files from older versions
+// (no checksum, or no header at all) are accepted as they are; those wrote
+// an empty file once every book was deleted, so an empty file is an empty
+// legacy snapshot.
+SnapshotCheck checkTextSnapshot(const FileView& view) {
+    if (view.size == 0 || view.data[0] != '#') {
+        return SNAPSHOT_OK;
+    }
+    const char* headerEnd = (const char*)memchr(view.data, '\n', view.size);
+    if (!headerEnd) {
+        return SNAPSHOT_DAMAGED;
+    }
+    string header(view.data, headerEnd);
+    size_t mark = header.find("|checksum|");
+    if (mark == string::npos) {
+        return SNAPSHOT_OK;
+    }
+    uint64_t stored = strtoull(header.c_str() + mark + 10, NULL, 16);
+    const char* body = headerEnd + 1;
+    return checksumBytes(body, view.data + view.size - body) == stored ? SNAPSHOT_OK : SNAPSHOT_DAMAGED;
+}
+
+// Opens and verifies a text snapshot, then hands its lines to `handleLine`.
+// Nothing is loaded from a damaged file.
+template <typename LineHandler>
+SnapshotCheck loadTextSnapshot(const string& path, LineHandler handleLine, long& generation) {
+    generation = 0;
+    FileView view;
+    if (!openFileView(path, view)) {
+        return errno == ENOENT ? SNAPSHOT_MISSING : SNAPSHOT_DAMAGED;
+    }
+    SnapshotCheck check = checkTextSnapshot(view);
+    if (check == SNAPSHOT_OK) {
+        generation = scanDataLines(view, handleLine);
+    }
+    closeFileView(view);
+    return check;
+}
+
+void reportDamagedSnapshot(const string& path, const string& freshStart) {
+    cout << " Error: " << path << " is damaged (truncated, unreadable or failing its checksum).\n";
+    cout << " Refusing to start so it is not overwritten. Restore it from a backup, or delete it\n";
+    cout << " to start " << freshStart << ".\n";
+}
+
+template <typename T>
+bool readValue(const char*& pos, const char* end, T& value) {
+    if ((size_t)(end - pos) < sizeof(value)) {
+        return false;
+    }
+    memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+// Validates a binary snapshot of the given kind and reads its header and
+// string table. On success `pos` points at the first record.
+bool openBinarySnapshot(const FileView& view, uint32_t kind, long& generation,
+                        vector<string>& strings, uint32_t& recordCount,
+                        const char*& pos, const char*& end) {
+    if (view.size < 4 + sizeof(uint64_t) || memcmp(view.data, "DULB", 4) != 0) {
+        return false;
+    }
+    end = view.data + view.size - sizeof(uint64_t);
+    uint64_t storedChecksum;
+    memcpy(&storedChecksum, end, sizeof(storedChecksum));
+    if (checksumBytes(view.data, end - view.data) != storedChecksum) {
+        return false;
+    }
+
+    pos = view.data + 4;
+    uint32_t version, fileKind, stringCount;
+    int64_t fileGeneration;
+    if (!readValue(pos, end, version) || version != BINARY_VERSION ||
+        !readValue(pos, end, fileKind) || fileKind != kind ||
+        !readValue(pos, end, fileGeneration) ||
+        !readValue(pos, end, stringCount) ||
+        !readValue(pos, end, recordCount)) {
+        return false;
+    }
+    generation = fileGeneration;
+
+    strings.reserve(stringCount);
+    for (uint32_t i = 0; i < stringCount; i++) {
+        uint32_t length;
+        if (!readValue(pos, end, length) || (size_t)(end - pos) < length) {
+            return false;
+        }
+        strings.push_back(string(pos, length));
+        pos += length;
+    }
+    return true;
+}
+
+// Reads just the "#generation|N" line of a text snapshot.
+long readTextGeneration(const string& path) {
+    ifstream file(path.c_str());
+    string line;
+    if (!getline(file, line)) {
+        return -1;
+    }
+    long generation = parseGeneration(line);
+    return generation < 0 ? 0 : generation;
+}
+
+bool loadBookBinary(const string& path, long& generation) {
+    FileView view;
+    if (!openFileView(path, view)) {
+        return false;
+    }
+
+    vector<string> strings;
+    uint32_t recordCount;
+    const char* pos;
+    const char* end;
+    const size_t recordSize = 3 * sizeof(uint32_t) + 3 * sizeof(int32_t) + sizeof(int64_t);
+    bool valid = openBinarySnapshot(view, BINARY_KIND_BOOKS, generation, strings, recordCount, pos, end) &&
+                 (size_t)(end - pos) == (size_t)recordCount * recordSize;
+    for (uint32_t i = 0; valid && i < recordCount; i++) {
+        uint32_t title, author, category;
+        int32_t year, totalCopies, availableCopies;
+        int64_t addedDate;
+        if (!readValue(pos, end, title) || !readValue(pos, end, author) ||
+            !readValue(pos, end, category) || !readValue(pos, end, year) ||
+            !readValue(pos, end, totalCopies) || !readValue(pos, end, availableCopies) ||
+            !readValue(pos, end, addedDate) ||
+            title >= strings.size() || author >= strings.size() || category >= strings.size()) {
+            valid = false;
+            break;
+        }
+        addBookToList(strings[title], strings[author], year, strings[category],
+                      addedDate, totalCopies, availableCopies);
+    }
+    closeFileView(view);
+
+    if (!valid) {
+        cout << " Warning: " << path << " is damaged; loading text data instead.\n";
+        while (head) {
+            removeBook(head);
+        }
+    }
+    return valid;
+}
+
+// Returns false, loading nothing, if the snapshot is damaged. Only a
+// missing snapshot (a first run) is seeded with the sample books.
+bool loadFromFile() {
+    long generation;
+    bool isMissing = false;
+    long textGeneration = readTextGeneration(LIBRARY_FILE);
+    if (textGeneration < 0 || !loadBookBinary(LIBRARY_BINARY_FILE, generation) ||
+        generation < textGeneration) {
+        while (head) {
+            removeBook(head);
+        }
+        SnapshotCheck check = loadTextSnapshot(LIBRARY_FILE, BookLineLoader(), generation);
+        if (check == SNAPSHOT_DAMAGED) {
+            reportDamagedSnapshot(LIBRARY_FILE, "over with the sample catalogue");
+            return false;
+        }
+        isMissing = check == SNAPSHOT_MISSING;
+    }
+
+    // The journal is opened once loadBorrowRecords() has replayed its
+    // borrow lines too; until then it carries the book generation.
+    vector<string> records;
+    readJournal(LIBRARY_JOURNAL, generation, records);
+    replayBookJournal(records);
+    libraryJournal.generation = generation;
+
+    if (isMissing) {
+        time_t dt = time(0);
+        addBookToList("Fikir Ena Desita", "Hana Gebreegziabher", 2005, "Fiction", dt, 3, 3);
+        addBookToList("Sew LeSew", "Aregawi Desalegn", 1998, "History", dt, 2, 2);
+        addBookToList("Yetintawi Tarik Tarik", "Molla Abebe", 2010, "Fiction", dt, 1, 1);
+        addBookToList("Introduction to Algorithms", "Thomas H. Cormen", 2009, "Computer Science", dt, 5, 5);
+        addBookToList("Clean Code", "Robert C. Martin", 2008, "Computer Science", dt, 4, 4);
+        journalCompactionDue = true;
+    }
+    return true;
+}
+
+void printCatalogueStats(const CatalogueStats& stats) {
+    cout << " Number of unique titles: " << stats.bookCount << "\n";
+    cout << " Total copies: " << stats.totalCopies << "\n";
+    cout << " Available copies: " << stats.availableCopies << "\n";
+    cout << " Checked out copies: " << (stats.totalCopies - stats.availableCopies) << "\n";
+    if (stats.bookCount > 0) {
+        cout << " Publication years: " << stats.oldestYear << "-" << stats.newestYear << "\n";
+    }
+    cout << "-------------------------\n";
+}
+
+void countBooksInCategory(const string& category) {
+    Symbol symbol = findSymbol(category);
+    CatalogueStats stats = {0, 0, 0, 0, 0};
+    if (symbol != NO_SYMBOL) {
+        stats = columnStats(symbol);
+    }
+
+    cout << "\n--- Book Count for Category: " << category << " ---\n";
+    printCatalogueStats(stats);
+}
+
+void countAllBooks() {
+    if (!head) {
+        cout << "No books in the library.\n";
+        return;
+    }
+
+    cout << "\n--- Total Library Statistics ---\n";
+    printCatalogueStats(columnStats(NO_SYMBOL));
+}
+
+void countBooksMenu() {
+    int choice;
+    do {
+        cout << "\n---------- Count Options -----------\n";
+        cout << "1. Count Books in a Category\n";
+        cout << "2. Count All Books\n";
+        cout << "3. Back to Main Menu\n";
+
+        if (!getSafeInt(choice, "Enter your choice (1-3): ", 1, 3)) return;
+
+        switch (choice) {
+            case 1: {
+                string category = selectCategory();
+                if (!category.empty()) {
+                    ReadLock lock(libraryLock);
+                    countBooksInCategory(category);
+                }
+                break;
+            }
+            case 2: {
+                ReadLock lock(libraryLock);
+                countAllBooks();
+                break;
+            }
+            case 3:
+                return;
+        }
+    } while (true);
+}
+
+// Everything is asked for first; the book is then looked up again under the
+// exclusive lock, and nothing is saved if another session added or removed
+// it in the meantime.
+void addBooks() {
+    int count;
+    if (!getSafeInt(count, "Enter the number of books to add (1-100): ", 1, 100)) return;
+
+    for (int i = 0; i < count; i++) {
+        cout << "\n--- Adding Book #" << i+1 << " ---\n";
+
+        string category = selectCategory();
+        if (category.empty()) {
+            cout << "Returning to main menu.\n";
+            return;
+        }
+
+        string title, author;
+        int year, totalCopies;
+
+        do {
+            cout << "Enter book title (minimum 4 letters, letters and spaces only): ";
+            getline(cin, title);
+        } while (!isValidInput(title, 4));
+
+        do {
+            cout << "Enter author name (minimum 4 letters, letters and spaces only): ";
+            getline(cin, author);
+        } while (!isValidInput(author, 4));
+
+        bool exists;
+        {
+            ReadLock lock(libraryLock);
+            exists = bookExists(title, author);
+        }
+
+        if (exists) {
+            cout << "Enter additional copies to add (1-1000): ";
+            if (!getSafeInt(totalCopies, "", 1, 1000)) return;
+        } else {
+            if (!getSafeInt(year, "Enter year of publication (1800-2025): ", 1800, 2025)) return;
+            if (!getSafeInt(totalCopies, "Enter total number of copies (1-1000): ", 1, 1000)) return;
+        }
+
+        {
+            WriteLock lock(libraryLock);
+            Book* temp = findBookAnyCategory(title, author);
+            if (exists && temp) {
+                int newTotal = temp->totalCopies + totalCopies;
+                int newAvailable = temp->availableCopies + totalCopies;
+                temp->totalCopies = newTotal;
+                temp->availableCopies = newAvailable;
+                cout << "Book already exists. Added " << totalCopies << " more copies.\n";
+                cout << " New total: " << newTotal << " copies (" << newAvailable << " available)\n";
+                journalBook(temp);
+            } else if (!exists && !temp) {
+                time_t dt = time(0);
+                Book* newBook = addBookToList(title, author, year, category, dt, totalCopies, totalCopies);
+                journalBook(newBook);
+                cout << "Book added successfully with " << totalCopies << " copies.\n";
+            } else {
+                cout << " The catalogue changed while you were typing; this book was not saved.\n";
+            }
+        }
+        waitForJournals();
+    }
+}
+
+// Splits one CSV or TSV row. Fields may be wrapped in double quotes (with
+// "" for a literal quote); surrounding spaces and a trailing \r are dropped.
+void splitImportRow(const string& line, char delimiter, vector<string>& fields) {
+    fields.clear();
+    string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == delimiter) {
+            fields.push_back(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+
+    for (size_t i = 0; i < fields.size(); i++) {
+        size_t first = fields[i].find_first_not_of(" \t\r");
+        size_t last = fields[i].find_last_not_of(" \t\r");
+        fields[i] = first == string::npos ? "" : fields[i].substr(first, last - first + 1);
+    }
+}
+
+bool parseImportNumber(const string& field, int min, int max, int& value) {
+    if (field.empty() || field.size() > 9) {
+        return false;
+    }
+    for (size_t i = 0; i < field.size(); i++) {
+        if (!isDigit(field[i])) {
+            return false;
+        }
+    }
+    value = stoi(field);
+    return value >= min && value <= max;
+}
+
+// Applies the addBooks rules to one row; returns an empty string if the
+// row is valid, otherwise the reason it was rejected.
+string checkImportRow(const vector<string>& fields, int& year, int& copies) {
+    if (fields.size() != 5) {
+        return "expected 5 fields, found " + to_string(fields.size());
+    }
+    if (checkLettersAndSpaces(fields[0], 4) != INPUT_OK) {
+        return "title must be at least 4 letters and spaces";
+    }
+    if (checkLettersAndSpaces(fields[1], 4) != INPUT_OK) {
+        return "author must be at least 4 letters and spaces";
+    }
+    if (!parseImportNumber(fields[2], 1800, 2025, year)) {
+        return "year must be between 1800 and 2025";
+    }
+    if (checkLettersAndSpaces(fields[3], 1) != INPUT_OK) {
+        return "category must be letters and spaces";
+    }
+    if (!parseImportNumber(fields[4], 1, 1000, copies)) {
+        return "copies must be between 1 and 1000";
+    }
+    return "";
+}
+
+// Non-interactive counterpart of addBooks for large acquisition lists.
+// Reads title,author,year,category,copies rows (comma-separated, or
+// tab-separated for .tsv files or when the first row contains a tab), adds
+// new books, adds copies to books that already exist with the same title
+// and author, and writes a single snapshot at the end instead of
+// journaling each row. A first row starting with "title" is a header.
+void importCatalogue(const string& path) {
+    ifstream in(path.c_str());
+    if (!in) {
+        cout << " Error: could not open " << path << ".\n";
+        return;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // Same identity bookExists uses (title and author, any category), hashed
+    // so each row is one lookup instead of a list scan.
+    unordered_map<string, Book*> existing;
+    for (Book* temp = head; temp; temp = temp->next) {
+        existing.insert(make_pair(to_string(temp->author) + '|' + temp->folded.text, temp));
+    }
+
+    const int MAX_REPORTED_REJECTS = 20;
+    bool tsv = path.size() >= 4 && foldCase(path.substr(path.size() - 4)) == ".tsv";
+    string line;
+    vector<string> fields;
+    int lineNumber = 0, rows = 0, added = 0, merged = 0, rejected = 0;
+    time_t now = time(0);
+
+    while (getline(in, line)) {
+        lineNumber++;
+        if (lineNumber == 1) {
+            tsv = tsv || line.find('\t') != string::npos;
+            if (foldCase(line.substr(0, 5)) == "title") {
+                continue;
+            }
+        }
+        if (line.find_first_not_of(" \t\r") == string::npos) {
+            continue;
+        }
+
+        rows++;
+        splitImportRow(line, tsv ? '\t' : ',', fields);
+        int year = 0, copies = 0;
+        string reason = checkImportRow(fields, year, copies);
+        if (!reason.empty()) {
+            if (++rejected <= MAX_REPORTED_REJECTS) {
+                cout << " Line " << lineNumber << " rejected: " << reason << "\n";
+            }
+            continue;
+        }
+
+        string key = to_string(intern(fields[1])) + '|' + foldCase(fields[0]);
+        auto it = existing.find(key);
+        if (it != existing.end()) {
+            Book* book = it->second;
+            book->totalCopies += copies;
+            book->availableCopies += copies;
+            syncBookColumns(book);
+            merged++;
+        } else {
+            existing[key] = addBookToList(fields[0], fields[1], year, fields[3], now, copies, copies);
+            added++;
+        }
+    }
+    if (rejected > MAX_REPORTED_REJECTS) {
+        cout << " ... and " << rejected - MAX_REPORTED_REJECTS << " more rejected rows\n";
+    }
+
+    if (added + merged > 0) {
+        saveToFile();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "\n--------- Import Summary -----------\n";
+    cout << " Rows read: " << rows << "\n";
+    cout << " New books: " << added << "\n";
+    cout << " Merged into existing books: " << merged << "\n";
+    cout << " Rejected: " << rejected << "\n";
+    cout << " Time: " << seconds * 1000 << " ms (" << (long)(rows / max(seconds, 1e-9)) << " rows/s)\n";
+    cout << "-----------------------------------------------\n";
+}
+
+void searchBooks() {
+    prepareSearchIndexes();
+    string query;
+    cout << "Enter a title or part of a title to search for: ";
+    getline(cin, query);
+    if (query.empty()) {
+        cout << "Returning to main menu.\n";
+        return;
+    }
+
+    ReadLock lock(libraryLock);
+    vector<TitleMatch> matches = searchTitles(query, SEARCH_RESULT_LIMIT);
+    if (matches.empty()) {
+        cout << " No books match '" << query << "'.\n";
+        printSuggestions(query, true);
+        return;
+    }
+
+    cout << "\n--- Books matching '" << query << "' ---\n";
+    for (size_t i = 0; i < matches.size(); i++) {
+        Book* book = matches[i].book;
+        cout << " " << i + 1 << ". " << book->title << " by " << symbolName(book->author)
+             << " [" << symbolName(book->category) << "] - " << book->availableCopies
+             << "/" << book->totalCopies << " available\n";
+    }
+    if (matches.size() == SEARCH_RESULT_LIMIT) {
+        cout << " (showing the first " << SEARCH_RESULT_LIMIT << " matches)\n";
+    }
+    if (matches[0].rank == MATCH_EXACT) {
+        displayBookDetails(matches[0].book);
+    }
+}
+
+bool bookDisplayBefore(const Book* a, const Book* b) {
+    if (a->category != b->category) {
+        return foldCase(symbolName(a->category)) < foldCase(symbolName(b->category));
+    }
+    return a->folded.text < b->folded.text;
+}
+
+const size_t QUERY_DISPLAY_LIMIT = 50;
+
+void findBooksMenu() {
+    prepareSearchIndexes();
+    BookQuery query = anyBook();
+
+    string author;
+    cout << "Author (blank for any): ";
+    getline(cin, author);
+    vector<string> names;
+    {
+        ReadLock lock(libraryLock);
+        if (!author.empty()) {
+            query.author = findSymbol(author);
+            if (query.author == NO_SYMBOL) {
+                cout << " No books by '" << author << "'.\n";
+                vector<FuzzyMatch> authors = suggestAuthors(author, SUGGESTION_LIMIT);
+                for (size_t i = 0; i < authors.size(); i++) {
+                    cout << (i == 0 ? " Did you mean:\n" : "") << "  - author " << symbolName(authors[i].id) << "\n";
+                }
+                return;
+            }
+        }
+        names = categoryNames();
+    }
+
+    int totalCategories = names.size();
+    int choice;
+    showCategoryMenu(names);
+    if (!getSafeInt(choice, "Select category (or " + to_string(totalCategories + 1) + " for any): ",
+                    1, totalCategories + 1)) {
+        return;
+    }
+    string category = choice <= totalCategories ? names[choice - 1] : "";
+
+    int year;
+    if (getOptionalInt(year, "Published from year (blank for any): ", 1800, 2025)) {
+        query.fromYear = year;
+    }
+    if (getOptionalInt(year, "Published up to year (blank for any): ", 1800, 2025)) {
+        query.toYear = year;
+    }
+
+    string answer;
+    cout << "Only books with available copies? (y/n): ";
+    getline(cin, answer);
+    query.availableOnly = answer == "y" || answer == "Y";
+
+    ReadLock lock(libraryLock);
+    if (!category.empty()) {
+        query.category = findSymbol(category);
+        if (query.category == NO_SYMBOL) {
+            cout << " No books match these conditions.\n";
+            return;
+        }
+    }
+    vector<Book*> results = findBooks(query);
+    if (results.empty()) {
+        cout << " No books match these conditions.\n";
+        return;
+    }
+
+    size_t shown = min(results.size(), QUERY_DISPLAY_LIMIT);
+    partial_sort(results.begin(), results.begin() + shown, results.end(), bookDisplayBefore);
+    cout << "\n--- " << results.size() << " matching book" << (results.size() == 1 ? "" : "s") << " ---\n";
+    for (size_t i = 0; i < shown; i++) {
+        Book* book = results[i];
+        cout << " " << book->title << " by " << symbolName(book->author) << " (" << book->year
+             << ") [" << symbolName(book->category) << "] - " << book->availableCopies << "/"
+             << book->totalCopies << " available\n";
+    }
+    if (shown < results.size()) {
+        cout << " (showing the first " << shown << ")\n";
+    }
+}
+
+void deleteBook() {
+    string category = selectCategory();
+    if (category.empty()) {
+        cout << "Returning to main menu.\n";
+        return;
+    }
+
+    string title;
+    cout << "Enter title to delete from category '" << category << "': ";
+    getline(cin, title);
+
+    int totalCopies, availableCopies;
+    {
+        ReadLock lock(libraryLock);
+        Book* temp = findBook(category, title);
+        if (!temp) {
+            cout << " Book not found in category '" << category << "'.\n";
+            return;
+        }
+
+        displayBookDetails(temp);
+        totalCopies = temp->totalCopies;
+        availableCopies = temp->availableCopies;
+    }
+
+    int copiesToDelete;
+    if (!getSafeInt(copiesToDelete, "Enter number of copies to delete (1-" + to_string(totalCopies) + "): ", 1, totalCopies)) {
+        return;
+    }
+
+    if (copiesToDelete > availableCopies) {
+        cout << " Warning: You're trying to delete more copies than are currently available.\n";
+        cout << " Only " << availableCopies << " copies are available to delete.\n";
+
+        char confirm;
+        cout << " Do you want to proceed? (y/n): ";
+        cin >> confirm;
+        cin.ignore();
+
+        if (tolower(confirm) != 'y') {
+            cout << " Delete operation cancelled.\n";
+            return;
+        }
+    }
+
+    string deletionTime = getCurrentDateTime();
+    string deletionDetails = "Deleted " + to_string(copiesToDelete) +
+                           " copies of '" + title +
+                           "' from category '" + category +
+                           "' on " + deletionTime;
+
+    {
+        WriteLock lock(libraryLock);
+        Book* temp = findBook(category, title);
+        if (!temp || temp->totalCopies != totalCopies) {
+            cout << " The book changed while you were typing; nothing was deleted.\n";
+            return;
+        }
+
+        if (copiesToDelete == temp->totalCopies) {
+            journalBookDeletion(temp);
+            removeBook(temp);
+            cout << " Book record completely deleted.\n";
+        } else {
+            temp->totalCopies -= copiesToDelete;
+            temp->availableCopies = max(0, temp->availableCopies - copiesToDelete);
+            journalBook(temp);
+            cout << " " << copiesToDelete << " copies removed from inventory.\n";
+            displayBookDetails(temp);
+        }
+    }
+    waitForJournals();
+
+    ofstream logfile("library_deletions.log", ios::app);
+    if (logfile.is_open()) {
+        logfile << deletionDetails << "\n";
+        logfile.close();
+    }
+
+    cout << " Deletion logged: " << deletionDetails << "\n";
+}
+
+// Deletes a whole category or the whole library. Books with active loans
+// are retired rather than freed so their borrow records stay valid, and the
+// result is written as a fresh snapshot instead of one journal line per book.
+void deleteAllBooks() {
+    bool empty;
+    {
+        ReadLock lock(libraryLock);
+        empty = !head;
+    }
+    if (empty) {
+        cout << "No books in the library.\n";
+        return;
+    }
+
+    int choice;
+    cout << "\n---------- Delete Options -----------\n";
+    cout << "1. Delete All Books in a Category\n";
+    cout << "2. Delete All Books in the Library\n";
+    cout << "3. Back to Main Menu\n";
+    if (!getSafeInt(choice, "Enter your choice (1-3): ", 1, 3) || choice == 3) return;
+
+    string category;
+    if (choice == 1) {
+        category = selectCategory();
+        if (category.empty()) {
+            cout << "Returning to main menu.\n";
+            return;
+        }
+    }
+    string scope = category.empty() ? "the entire library" : "category '" + category + "'";
+
+    char confirm;
+    cout << " Delete every book in " << scope << "? (y/n): ";
+    cin >> confirm;
+    cin.ignore();
+    if (tolower(confirm) != 'y') {
+        cout << " Delete operation cancelled.\n";
+        return;
+    }
+
+    int deleted = 0;
+    int retired = 0;
+    {
+        WriteLock lock(libraryLock);
+        if (category.empty()) {
+            for (Book* temp = head; temp; temp = temp->next) {
+                deleted++;
+                retired += temp->loanCount > 0;
+            }
+            clearCatalogue();
+        } else {
+            Category* cat = findCategory(category);
+            for (Book* temp = cat ? cat->first : NULL; temp; ) {
+                Book* next = temp->categoryNext;
+                deleted++;
+                retired += temp->loanCount > 0;
+                removeBook(temp);
+                temp = next;
+            }
+        }
+        saveToFile();
+    }
+
+    string deletionDetails = "Deleted all " + to_string(deleted) + " books from " + scope +
+                             " on " + getCurrentDateTime();
+    ofstream logfile("library_deletions.log", ios::app);
+    if (logfile.is_open()) {
+        logfile << deletionDetails << "\n";
+        logfile.close();
+    }
+
+    if (retired > 0) {
+        cout << " " << retired << " of them are still on loan and stay in the borrow records until returned.\n";
+    }
+    cout << " Deletion logged: " << deletionDetails << "\n";
+}
+
+// The new values are collected without holding the lock (showing the book
+// as it was when chosen) and applied together under the exclusive lock,
+// provided the book is still there and unchanged in title and author.
+void updateBook() {
+    cout << "\n===== Update Book =====\n";
+
+    prepareSearchIndexes();
+    string category = selectCategory();
+    if (category.empty()) {
+        cout << "Update cancelled.\n";
+        return;
+    }
+
+    string title;
+    cout << "Enter title of the book to update in category '" << category << "': ";
+    getline(cin, title);
+
+    string oldCategory, oldTitle, oldAuthor;
+    int oldYear, oldTotalCopies;
+    {
+        ReadLock lock(libraryLock);
+        Book* temp = findBook(category, title);
+        if (!temp) {
+            cout << "Book not found in category '" << category << "'.\n";
+            printSuggestions(title, false);
+            return;
+        }
+
+        cout << "\n--- Current Book Information ---";
+        displayBookDetails(temp);
+
+        oldCategory = symbolName(temp->category);
+        oldTitle = temp->title;
+        oldAuthor = symbolName(temp->author);
+        oldYear = temp->year;
+        oldTotalCopies = temp->totalCopies;
+    }
+
+    cout << "\nEnter new details for the book (leave blank to keep current value):\n";
+
+    string newTitle;
+    cout << "Enter new title [" << oldTitle << "]: ";
+    getline(cin, newTitle);
+    if (!newTitle.empty()) {
+        while (!isValidInput(newTitle, 4)) {
+            cout << "Enter new title [" << oldTitle << "]: ";
+            getline(cin, newTitle);
+            if (newTitle.empty()) break;
+        }
+    }
+    string finalTitle = newTitle.empty() ? oldTitle : newTitle;
+
+    string newAuthor;
+    cout << "Enter new author [" << oldAuthor << "]: ";
+    getline(cin, newAuthor);
+    if (!newAuthor.empty()) {
+        while (!isValidInput(newAuthor, 4)) {
+            cout << "Enter new author [" << oldAuthor << "]: ";
+            getline(cin, newAuthor);
+            if (newAuthor.empty()) break;
+        }
+    }
+    string finalAuthor = newAuthor.empty() ? oldAuthor : newAuthor;
+
+    if (!newTitle.empty() || !newAuthor.empty()) {
+        ReadLock lock(libraryLock);
+        Book* existing = findBookAnyCategory(finalTitle, finalAuthor);
+        if (existing && existing != findExactBook(oldCategory, oldTitle, oldAuthor)) {
+            cout << "A book with this title and author already exists.\n";
+            return;
+        }
+    }
+
+    cout << "\nCurrent category: " << oldCategory << endl;
+    cout << "Select new category:\n";
+    string newCategory = selectCategory();
+    string finalCategory = newCategory.empty() ? oldCategory : newCategory;
+
+    string yearInput;
+    int newYear = oldYear;
+    cout << "Enter new year [" << oldYear << "]: ";
+    getline(cin, yearInput);
+    if (!yearInput.empty()) {
+        while (true) {
+            bool valid = true;
+            for (char c : yearInput) {
+                if (!isDigit(c)) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (valid) {
+                newYear = stoi(yearInput);
+                if (newYear >= 1800 && newYear <= 2025) {
+                    break;
+                }
+            }
+            newYear = oldYear;
+            cout << "Please enter a valid year between 1800 and 2025 [" << oldYear << "]: ";
+            getline(cin, yearInput);
+            if (yearInput.empty()) break;
+        }
+    }
+
+    string copiesInput;
+    int newTotalCopies = 0;
+    cout << "Enter new total copies [" << oldTotalCopies << "]: ";
+    getline(cin, copiesInput);
+    if (!copiesInput.empty()) {
+        while (true) {
+            bool valid = true;
+            for (char c : copiesInput) {
+                if (!isDigit(c)) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (valid) {
+                newTotalCopies = stoi(copiesInput);
+                if (newTotalCopies >= 1 && newTotalCopies <= 1000) {
+                    break;
+                }
+            }
+            newTotalCopies = 0;
+            cout << "Please enter a valid number between 1 and 1000 [" << oldTotalCopies << "]: ";
+            getline(cin, copiesInput);
+            if (copiesInput.empty()) break;
+        }
+    }
+
+    {
+        WriteLock lock(libraryLock);
+        Book* temp = findExactBook(oldCategory, oldTitle, oldAuthor);
+        if (!temp) {
+            cout << "The book was changed or deleted while you were editing; nothing was updated.\n";
+            return;
+        }
+        Book* existing = findBookAnyCategory(finalTitle, finalAuthor);
+        if (existing && existing != temp) {
+            cout << "A book with this title and author already exists.\n";
+            return;
+        }
+
+        Symbol categorySymbol = intern(finalCategory);
+        if (finalTitle != temp->title || categorySymbol != temp->category) {
+            renameBook(temp, finalTitle, categorySymbol);
+        }
+        if (!newAuthor.empty()) {
+            changeAuthor(temp, intern(finalAuthor));
+        }
+        if (newYear != temp->year) {
+            changeYear(temp, newYear);
+        }
+        if (newTotalCopies > 0) {
+            int difference = newTotalCopies - temp->totalCopies;
+            temp->availableCopies += difference;
+            if (temp->availableCopies < 0) temp->availableCopies = 0;
+            if (temp->availableCopies > newTotalCopies) temp->availableCopies = newTotalCopies;
+            temp->totalCopies = newTotalCopies;
+        }
+
+        journalBook(oldCategory, oldTitle, oldAuthor, temp);
+        cout << "\nBook updated successfully!\n";
+        cout << "--- Updated Book Information ---";
+        displayBookDetails(temp);
+    }
+    waitForJournals();
+}
+
+string formatBorrowFields(BorrowRecord* record) {
+    return record->book->title + "|" + symbolName(record->book->category) + "|" +
+           symbolName(record->borrowerName) + "|" + symbolName(record->borrowerId) + "|" +
+           to_string(record->borrowedCopies) + "|" + to_string((long long)record->borrowDate) + "|" +
+           to_string((long long)record->returnDate) + "|" + (record->returned ? "1" : "0");
+}
+
+bool writeBorrowBinary(const string& path, long generation) {
+    BinaryStringTable table;
+    string records;
+    uint32_t count = 0;
+    for (BorrowRecord* temp = borrowHead; temp; temp = temp->next) {
+        appendValue<uint32_t>(records, table.intern(temp->book->title));
+        appendValue<uint32_t>(records, table.intern(symbolName(temp->book->category)));
+        appendValue<uint32_t>(records, table.intern(symbolName(temp->borrowerName)));
+        appendValue<uint32_t>(records, table.intern(symbolName(temp->borrowerId)));
+        appendValue<int32_t>(records, temp->borrowedCopies);
+        appendValue<int32_t>(records, temp->returned ? 1 : 0);
+        appendValue<int64_t>(records, temp->borrowDate);
+        appendValue<int64_t>(records, temp->returnDate);
+        count++;
+    }
+    return writeFileContents(path, encodeBinarySnapshot(BINARY_KIND_BORROWS, generation, count, table, records));
+}
+
+// The borrow half of a compaction; saveToFile() writes it first.
+bool writeBorrowSnapshot(long generation) {
+string body;
+for (BorrowRecord* temp = borrowHead; temp; temp = temp->next) {
+    body += formatBorrowFields(temp);
+    body += '\n';
+}
+if (!writeTextSnapshot(BORROW_FILE, generation, body)) {
+    cout << " Error: could not write " << BORROW_FILE << ".\n";
+    return false;
+}
+if (!writeBorrowBinary(BORROW_BINARY_FILE, generation)) {
+    cout << " Warning: could not write " << BORROW_BINARY_FILE << ".\n";
+    remove(BORROW_BINARY_FILE.c_str());
+}
+return true;
+}
+
+// Active (unreturned) loans per patron, keyed by interned borrower ID.
+// Returned records stay in the borrow list for history but leave the index.
+unordered_map<Symbol, vector<BorrowRecord*> > activeLoans;
+
+// Min-heap of active loans ordered by due date, for the overdue report.
+// Returned loans are dropped lazily when they reach the top; once they make
+// up half the heap it is rebuilt from the active loans.
+struct DueLater {
+    bool operator()(const BorrowRecord* a, const BorrowRecord* b) const {
+        return a->returnDate > b->returnDate;
+    }
+};
+
+vector<BorrowRecord*> dueHeap;
+size_t staleDueEntries = 0;
+
+void rebuildDueHeap() {
+    dueHeap.clear();
+    for (auto it = activeLoans.begin(); it != activeLoans.end(); ++it) {
+        dueHeap.insert(dueHeap.end(), it->second.begin(), it->second.end());
+    }
+    make_heap(dueHeap.begin(), dueHeap.end(), DueLater());
+    staleDueEntries = 0;
+}
+
+void indexLoan(BorrowRecord* record) {
+    activeLoans[record->borrowerId].push_back(record);
+    dueHeap.push_back(record);
+    push_heap(dueHeap.begin(), dueHeap.end(), DueLater());
+}
+
+void unindexLoan(BorrowRecord* record) {
+    auto it = activeLoans.find(record->borrowerId);
+    if (it == activeLoans.end()) {
+        return;
+    }
+    vector<BorrowRecord*>& loans = it->second;
+    loans.erase(find(loans.begin(), loans.end(), record));
+    if (loans.empty()) {
+        activeLoans.erase(it);
+    }
+}
+
+const vector<BorrowRecord*>* findActiveLoans(const string& borrowerId) {
+    auto it = activeLoans.find(findSymbol(borrowerId));
+    return it == activeLoans.end() ? NULL : &it->second;
+}
+
+BorrowRecord* findActiveLoan(const string& borrowerId, const string& title, const string& category) {
+    const vector<BorrowRecord*>* loans = findActiveLoans(borrowerId);
+    if (!loans) {
+        return NULL;
+    }
+    Symbol categorySymbol = findSymbol(category);
+    FoldedTitle folded = foldTitle(title);
+    for (size_t i = 0; i < loans->size(); i++) {
+        BorrowRecord* record = (*loans)[i];
+        if (record->book->category == categorySymbol && titleMatches(record->book, folded)) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+void markReturned(BorrowRecord* record) {
+    if (record->returned) {
+        return;
+    }
+    unindexLoan(record);
+    record->borrowedCopies = 0;
+    record->returned = true;
+    if (++staleDueEntries * 2 > dueHeap.size()) {
+        rebuildDueHeap();
+    }
+}
+
+// Builds a loan from its stored fields, pointing it at the live book (or a
+// retired placeholder) and interning the borrower's name and ID.
+BorrowRecord* newBorrowRecord(Book* book, const string& name, const string& id, int copies,
+                              time_t borrowDate, time_t returnDate, bool returned) {
+    book->loanCount++;
+    return borrowPool.create(BorrowRecord{
+        book, intern(name), intern(id), copies, borrowDate, returnDate, returned, 0, NULL
+    });
+}
+
+void appendBorrowRecord(BorrowRecord* record) {
+if (!record->returned) {
+    indexLoan(record);
+}
+record->recordNumber = borrowRecordCount++;
+if (!borrowHead) {
+    borrowHead = record;
+} else {
+    borrowTail->next = record;
+}
+borrowTail = record;
+}
+
+void journalBorrowRecord(BorrowRecord* record) {
+if (appendJournal(libraryJournal, "A|" + formatBorrowFields(record))) {
+    saveToFile();
+}
+}
+
+void journalReturn(BorrowRecord* record) {
+if (appendJournal(libraryJournal, "R|" + to_string(record->recordNumber))) {
+    saveToFile();
+}
+}
+
+void replayBorrowJournal(const vector<string>& records) {
+vector<BorrowRecord*> byNumber;
+for (BorrowRecord* temp = borrowHead; temp; temp = temp->next) {
+    byNumber.push_back(temp);
+}
+
+for (size_t r = 0; r < records.size(); r++) {
+    vector<string> tokens = splitFields(records[r]);
+    if (tokens[0] == "A" && tokens.size() == 9) {
+        BorrowRecord* newRecord = newBorrowRecord(
+            resolveLoanBook(tokens[2], tokens[1]), tokens[3], tokens[4],
+            stoi(tokens[5]), parseStoredDate(tokens[6]), parseStoredDate(tokens[7]),
+            tokens[8] == "1");
+        appendBorrowRecord(newRecord);
+        byNumber.push_back(newRecord);
+    } else if (tokens[0] == "R" && tokens.size() == 2) {
+        size_t number = stoul(tokens[1]);
+        if (number < byNumber.size()) {
+            markReturned(byNumber[number]);
+        }
+    }
+}
+}
+
+struct BorrowLineLoader {
+    void operator()(const char* begin, const char* end) const {
+        FieldSpan fields[8];
+        int copies;
+        if (splitFieldSpans(begin, end, fields, 8) >= 7 &&
+            parseIntField(fields[4], copies)) {
+            bool returned = fields[7].end - fields[7].begin == 1 && *fields[7].begin == '1';
+            BorrowRecord* newRecord = newBorrowRecord(
+                resolveLoanBook(fieldString(fields[1]), fieldString(fields[0])),
+                fieldString(fields[2]), fieldString(fields[3]),
+                copies, parseStoredDate(fields[5].begin, fields[5].end),
+                parseStoredDate(fields[6].begin, fields[6].end), returned);
+            appendBorrowRecord(newRecord);
+        }
+    }
+};
+
+
+void clearBorrowRecords() {
+    while (borrowHead) {
+        BorrowRecord* next = borrowHead->next;
+        borrowHead->book->loanCount--;
+        borrowPool.destroy(borrowHead);
+        borrowHead = next;
+    }
+    borrowTail = NULL;
+    borrowRecordCount = 0;
+    activeLoans.clear();
+    dueHeap.clear();
+    staleDueEntries = 0;
+}
+
+bool loadBorrowBinary(const string& path, long& generation) {
+    FileView view;
+    if (!openFileView(path, view)) {
+        return false;
+    }
+
+    vector<string> strings;
+    uint32_t recordCount;
+    const char* pos;
+    const char* end;
+    const size_t recordSize = 4 * sizeof(uint32_t) + 2 * sizeof(int32_t) + 2 * sizeof(int64_t);
+    bool valid = openBinarySnapshot(view, BINARY_KIND_BORROWS, generation, strings, recordCount, pos, end) &&
+                 (size_t)(end - pos) == (size_t)recordCount * recordSize;
+    for (uint32_t i = 0; valid && i < recordCount; i++) {
+        uint32_t title, category, name, id;
+        int32_t copies, returned;
+        int64_t borrowDate, returnDate;
+        if (!readValue(pos, end, title) || !readValue(pos, end, category) ||
+            !readValue(pos, end, name) || !readValue(pos, end, id) ||
+            !readValue(pos, end, copies) || !readValue(pos, end, returned) ||
+            !readValue(pos, end, borrowDate) || !readValue(pos, end, returnDate) ||
+            title >= strings.size() || category >= strings.size() ||
+            name >= strings.size() || id >= strings.size()) {
+            valid = false;
+            break;
+        }
+        appendBorrowRecord(newBorrowRecord(
+            resolveLoanBook(strings[category], strings[title]), strings[name], strings[id],
+            copies, (time_t)borrowDate, (time_t)returnDate, returned != 0));
+    }
+    closeFileView(view);
+
+    if (!valid) {
+        cout << " Warning: " << path << " is damaged; loading text data instead.\n";
+        clearBorrowRecords();
+    }
+    return valid;
+}
+
+// Returns false, loading nothing, if the snapshot is damaged.
+bool loadBorrowRecords() {
+long generation;
+long textGeneration = readTextGeneration(BORROW_FILE);
+if (textGeneration < 0 || !loadBorrowBinary(BORROW_BINARY_FILE, generation) ||
+    generation < textGeneration) {
+    clearBorrowRecords();
+    if (loadTextSnapshot(BORROW_FILE, BorrowLineLoader(), generation) == SNAPSHOT_DAMAGED) {
+        reportDamagedSnapshot(BORROW_FILE, "with no borrow records");
+        return false;
+    }
+}
+
+vector<string> legacy;
+bool hasLegacy = ifstream(LEGACY_BORROW_JOURNAL.c_str()).good();
+readJournal(LEGACY_BORROW_JOURNAL, generation, legacy);
+replayBorrowJournal(legacy);
+vector<string> records;
+int replayed = readJournal(LIBRARY_JOURNAL, generation, records);
+replayBorrowJournal(records);
+
+// Keep appending only if both snapshots and the journal agree; otherwise
+// fold everything into fresh snapshots under a newer generation.
+if (replayed >= 0 && generation == libraryJournal.generation && !hasLegacy && !journalCompactionDue) {
+    openJournal(libraryJournal, generation, replayed);
+    return true;
+}
+libraryJournal.generation = max(generation, libraryJournal.generation);
+saveToFile();
+remove(LEGACY_BORROW_JOURNAL.c_str());
+return true;
+}
+
+BorrowRecord* addBorrowRecord(Book* book, const string& name, const string& id, int copies,
+                time_t borrowDate, time_t returnDate) {
+BorrowRecord* newRecord = newBorrowRecord(book, name, id, copies, borrowDate, returnDate, false);
+
+appendBorrowRecord(newRecord);
+journalBorrowRecord(newRecord);
+return newRecord;
+}
+
+void displayBorrowRules() {
+cout << "\n--------- Borrowing Rules -----------\n";
+cout << "1. You can borrow one copy of any book, but not multiple copies of the same book.\n";
+cout << "2. The standard borrowing period is 14 days.\n";
+cout << "3. Late returns will incur a fine of 5 birr per day.\n";
+cout << "4. Books must be returned in the same condition as borrowed.\n";
+cout << "5. Lost or damaged books must be replaced or paid for.\n";
+cout << "-----------------------------------------------\n";
+}
+
+bool hasBorrowedSpecificBook(const string& borrowerId, const string& title, const string& category) {
+return findActiveLoan(borrowerId, title, category) != NULL;
+}
+
+enum LoanStatus {
+    LOAN_OK,
+    LOAN_NO_SUCH_BOOK,
+    LOAN_NO_COPIES,
+    LOAN_ALREADY_BORROWED,
+    LOAN_NOT_BORROWED
+};
+
+string loanStatusCode(LoanStatus status) {
+    switch (status) {
+        case LOAN_OK: return "OK";
+        case LOAN_NO_SUCH_BOOK: return "NO_SUCH_BOOK";
+        case LOAN_NO_COPIES: return "NO_COPIES";
+        case LOAN_ALREADY_BORROWED: return "ALREADY_BORROWED";
+        case LOAN_NOT_BORROWED: return "NOT_BORROWED";
+    }
+    return "";
+}
+
+string loanStatusMessage(LoanStatus status) {
+    switch (status) {
+        case LOAN_OK: return "OK";
+        case LOAN_NO_SUCH_BOOK: return "Book not found.";
+        case LOAN_NO_COPIES: return "Sorry, no copies of this book are currently available.";
+        case LOAN_ALREADY_BORROWED: return "Sorry, you have already borrowed a copy of this book.";
+        case LOAN_NOT_BORROWED: return "No matching active borrow record found.";
+    }
+    return "";
+}
+
+// Lends one copy of a book. The lookup, the availability check, the
+// decrement and the new loan all happen under the caller's exclusive lock,
+// so two terminals can never both take the last copy, and the decrement and
+// the loan are journaled as one group. Caller must hold libraryLock
+// exclusively.
+LoanStatus checkoutBook(const string& category, const string& title, const string& borrowerName,
+                        const string& borrowerId, BorrowRecord*& record) {
+    Book* book = findBook(category, title);
     if (!book) {
+        return LOAN_NO_SUCH_BOOK;
+    }
+    if (hasBorrowedSpecificBook(borrowerId, title, category)) {
+        return LOAN_ALREADY_BORROWED;
+    }
+    if (book->availableCopies <= 0) {
+        return LOAN_NO_COPIES;
+    }
+
+    beginJournalGroup();
+    book->availableCopies -= 1;
+    journalBook(book);
+    record = addBorrowRecord(book, borrowerName, borrowerId, 1, time(0), calculateReturnDate(14));
+    commitJournalGroup();
+    return LOAN_OK;
+}
+
+// Takes back the copy lent to this borrower, returning how many days late
+// it is. A loan whose book has since been deleted (a retired book) is still
+// closed; there is just no copy count to give it back to. Caller must hold
+// libraryLock exclusively.
+LoanStatus checkinBook(const string& category, const string& title, const string& borrowerName,
+                       const string& borrowerId, time_t returnDate, int& daysLate) {
+    Book* book = findBook(category, title);
+    BorrowRecord* record = findActiveLoan(borrowerId, title, category);
+    if (!record || record->borrowerName != findSymbol(borrowerName)) {
+        return book ? LOAN_NOT_BORROWED : LOAN_NO_SUCH_BOOK;
+    }
+
+    daysLate = daysBetweenDates(record->returnDate, returnDate);
+    beginJournalGroup();
+    if (book == record->book) {
+        book->availableCopies += 1;
+        journalBook(book);
+    }
+
+    markReturned(record);
+    journalReturn(record);
+    commitJournalGroup();
+    return LOAN_OK;
+}
+
+const int MAX_BOOKS_PER_CHECKOUT = 5;
+
+struct LoanRequest {
+    string category;
+    string title;
+};
+
+// Lends one copy of each requested book, or none at all. Every title is
+// resolved through the book index first and checked (found, not asked for
+// twice, not already on loan to this borrower, a copy available); only if
+// all pass are the copies taken, and their journal entries are committed
+// as one group. `statuses` says what was wrong with each request and the
+// first failure is returned. Caller must hold libraryLock exclusively.
+LoanStatus checkoutBooks(const vector<LoanRequest>& requests, const string& borrowerName,
+                         const string& borrowerId, vector<LoanStatus>& statuses,
+                         vector<BorrowRecord*>& records) {
+    vector<Book*> books(requests.size(), NULL);
+    statuses.assign(requests.size(), LOAN_OK);
+    LoanStatus result = LOAN_OK;
+    for (size_t i = 0; i < requests.size(); i++) {
+        Book* book = findBook(requests[i].category, requests[i].title);
+        books[i] = book;
+        if (!book) {
+            statuses[i] = LOAN_NO_SUCH_BOOK;
+        } else if (find(books.begin(), books.begin() + i, book) != books.begin() + i ||
+                   hasBorrowedSpecificBook(borrowerId, requests[i].title, requests[i].category)) {
+            statuses[i] = LOAN_ALREADY_BORROWED;
+        } else if (book->availableCopies <= 0) {
+            statuses[i] = LOAN_NO_COPIES;
+        }
+        if (result == LOAN_OK) {
+            result = statuses[i];
+        }
+    }
+    if (result != LOAN_OK) {
+        return result;
+    }
+
+    time_t borrowDate = time(0);
+    time_t returnDate = calculateReturnDate(14);
+    records.clear();
+    beginJournalGroup();
+    for (size_t i = 0; i < books.size(); i++) {
+        books[i]->availableCopies -= 1;
+        journalBook(books[i]);
+        records.push_back(addBorrowRecord(books[i], borrowerName, borrowerId, 1, borrowDate, returnDate));
+    }
+    commitJournalGroup();
+    return LOAN_OK;
+}
+
+// Asks for a borrower ID until it is long enough. Returns false if input
+// ends first.
+bool readBorrowerId(string& borrowerId) {
+    while (true) {
+        cout << "Enter your ID (minimum 3 characters, letters or numbers): ";
+        if (!getline(cin, borrowerId)) {
+            return false;
+        }
+        if (borrowerId.length() >= 3) {
+            return true;
+        }
+        cout << "ID must be at least 3 characters long.\n";
+    }
+}
+
+// Asks for the borrower's name, then their ID.
+bool readBorrower(string& borrowerName, string& borrowerId) {
+    do {
+        cout << "Enter your full name (minimum 3 letters, no numbers): ";
+        if (!getline(cin, borrowerName)) {
+            return false;
+        }
+    } while (!isValidInput(borrowerName, 3));
+    return readBorrowerId(borrowerId);
+}
+
+// Browsing and the early checks hold the lock shared, and only while
+// reading; checkoutBook() then repeats them under the exclusive lock, since
+// another terminal may have taken the last copy while this one was typing.
+void borrowBook() {
+    prepareSearchIndexes();
+    string category = selectCategory();
+    if (category.empty()) {
+        cout << "Borrowing cancelled.\n";
+        return;
+    }
+
+    ReadLock browsing(libraryLock);
+    displayBooksByCategory(category);
+    browsing.unlock();
+
+    string title;
+    cout << "Enter the title of the book you want to borrow: ";
+    getline(cin, title);
+
+    browsing.lock();
+    Book* temp = findBook(category, title);
+    if (!temp) {
         cout << "Book not found in category '" << category << "'.\n";
+        printSuggestions(title, false);
+        return;
+    }
+
+    displayBookDetails(temp);
+
+    if (temp->availableCopies <= 0) {
+        cout << "Sorry, no copies of this book are currently available.\n";
+        return;
+    }
+    browsing.unlock();
+
+    string borrowerName, borrowerId;
+    if (!readBorrower(borrowerName, borrowerId)) {
+        return;
+    }
+
+    browsing.lock();
+    bool alreadyBorrowed = hasBorrowedSpecificBook(borrowerId, title, category);
+    browsing.unlock();
+    if (alreadyBorrowed) {
+        cout << "Sorry, you have already borrowed a copy of this book.\n";
+        cout << "Please return it before borrowing another copy.\n";
+        return;
+    }
+
+    displayBorrowRules();
+
+    char confirm;
+    cout << "Do you want to proceed with borrowing 1 copy of '" << title << "'? (y/n): ";
+    cin >> confirm;
+    cin.ignore();
+
+    if (tolower(confirm) == 'y') {
+        BorrowRecord* record = NULL;
+        LoanStatus status;
+        time_t borrowDate = 0, returnDate = 0;
+        {
+            WriteLock lock(libraryLock);
+            status = checkoutBook(category, title, borrowerName, borrowerId, record);
+            if (status == LOAN_OK) {
+                borrowDate = record->borrowDate;
+                returnDate = record->returnDate;
+            }
+        }
+        waitForJournals();
+        if (status != LOAN_OK) {
+            cout << loanStatusMessage(status) << "\n";
+            return;
+        }
+
+        cout << "\n--------- Borrowing Confirmation -----------\n";
+        cout << " Book Title: " << title << "\n";
+        cout << " Category: " << category << "\n";
+        cout << " Borrower Name: " << borrowerName << "\n";
+        cout << " Borrower ID: " << borrowerId << "\n";
+        cout << " Copies Borrowed: 1\n";
+        cout << " Borrow Date: " << formatDateTime(borrowDate) << "\n";
+        cout << " Due Date: " << formatDateTime(returnDate) << "\n";
+        cout << "-------------------------------------\n";
+        cout << "Thank you for borrowing from our library!\n";
+    } else {
+        cout << "Borrowing cancelled.\n";
+    }
+}
+
+// The categories a return can name: the live ones, then any whose books
+// were all deleted while some are still on loan. Caller must hold
+// libraryLock.
+vector<string> returnCategoryNames() {
+    vector<string> names = categoryNames();
+    for (auto it = activeLoans.begin(); it != activeLoans.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            string name = symbolName(it->second[i]->book->category);
+            if (find(names.begin(), names.end(), name) == names.end()) {
+                names.push_back(name);
+            }
+        }
+    }
+    return names;
+}
+
+void returnBook() {
+    prepareSearchIndexes();
+    vector<string> names;
+    {
+        ReadLock lock(libraryLock);
+        names = returnCategoryNames();
+    }
+    string category = selectCategory(names);
+    if (category.empty()) {
+        cout << "Returning cancelled.\n";
+        return;
+    }
+
+    ReadLock browsing(libraryLock);
+    displayBooksByCategory(category);
+    browsing.unlock();
+
+    string title;
+    cout << "Enter the title of the book you want to return: ";
+    getline(cin, title);
+
+    string borrowerName, borrowerId;
+    if (!readBorrower(borrowerName, borrowerId)) {
+        return;
+    }
+
+    browsing.lock();
+    BorrowRecord* selectedRecord = findActiveLoan(borrowerId, title, category);
+    if (selectedRecord && selectedRecord->borrowerName != findSymbol(borrowerName)) {
+        selectedRecord = NULL;
+    }
+
+    if (!selectedRecord) {
+        if (!findBook(category, title)) {
+            cout << "Book not found in category '" << category << "'.\n";
+            printSuggestions(title, false);
+        } else {
+            cout << "No matching active borrow record found.\n";
+        }
+        return;
+    }
+
+    cout << "\nFound borrow record:\n";
+    cout << "Borrowed 1 copy on " << formatDateTime(selectedRecord->borrowDate)
+         << " (Due: " << formatDateTime(selectedRecord->returnDate) << ")\n";
+    browsing.unlock();
+
+    char confirm;
+    cout << "Confirm return of 1 copy of '" << title << "'? (y/n): ";
+    cin >> confirm;
+    cin.ignore();
+
+    if (tolower(confirm) != 'y') {
+        cout << "Return cancelled.\n";
+        return;
+    }
+
+    time_t returnDate = time(0);
+    int daysLate = 0;
+    LoanStatus status;
+    {
+        WriteLock lock(libraryLock);
+        status = checkinBook(category, title, borrowerName, borrowerId, returnDate, daysLate);
+    }
+    waitForJournals();
+    if (status != LOAN_OK) {
+        cout << loanStatusMessage(status) << "\n";
+        return;
+    }
+
+    cout << "\n>>>>>>> Return Confirmation <<<<<<<<\n";
+    cout << " Book Title: " << title << "\n";
+    cout << " Category: " << category << "\n";
+    cout << " Borrower Name: " << borrowerName << "\n";
+    cout << " Borrower ID: " << borrowerId << "\n";
+    cout << " Copies Returned: 1\n";
+    cout << " Return Date: " << formatDateTime(returnDate) << "\n";
+
+    if (daysLate > 0) {
+        int fine = calculateFine(daysLate);
+        cout << " WARNING: This return is " << daysLate << " days late!\n";
+        cout << " Fine imposed: " << fine << " birr\n";
+        cout << " Please pay the fine at the library desk.\n";
+    } else {
+        cout << " Book returned on time. Thank you!\n";
+    }
+ cout << "------------------------------------\n";
+}
+
+
+
+
+
+bool isChosen(const vector<LoanRequest>& requests, const string& category, const string& title) {
+    for (size_t i = 0; i < requests.size(); i++) {
+        if (caseInsensitiveCompare(requests[i].category, category) &&
+            caseInsensitiveCompare(requests[i].title, title)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Collects up to five titles, checking each as it is entered so a typo or
+// an unavailable book can be replaced on the spot, then borrows them all
+// in one checkoutBooks() call.
+void borrowMultipleBooks() {
+    prepareSearchIndexes();
+
+    string borrowerName, borrowerId;
+    if (!readBorrower(borrowerName, borrowerId)) {
         return;
     }
 
-    BorrowRecord* currentRecord = borrowHead;
-    BorrowRecord* selectedRecord = NULL;
+    int count;
+    if (!getSafeInt(count, "How many books do you want to borrow (1-" + to_string(MAX_BOOKS_PER_CHECKOUT) + "): ",
+                    1, MAX_BOOKS_PER_CHECKOUT)) return;
 
-    while (currentRecord) {
-        if (caseInsensitiveCompare(currentRecord->bookTitle, title) &&
-            caseInsensitiveCompare(currentRecord->bookCategory, category) &&
-            caseInsensitiveCompare(currentRecord->borrowerName, borrowerName) &&
-            caseInsensitiveCompare(currentRecord->borrowerId, borrowerId) &&
-            !currentRecord->returned) {
-            selectedRecord = currentRecord;
-            break;
+    vector<LoanRequest> requests;
+    while ((int)requests.size() < count) {
+        cout << "\n--- Book #" << requests.size() + 1 << " of " << count << " ---\n";
+        string category = selectCategory();
+        if (category.empty()) {
+            cout << "Borrowing cancelled.\n";
+            return;
         }
-        currentRecord = currentRecord->next;
-    }
 
-    if (!selectedRecord) {
-        cout << "No matching active borrow record found.\n";
-        return;
+        ReadLock browsing(libraryLock);
+        displayBooksByCategory(category);
+        browsing.unlock();
+
+        string title;
+        cout << "Enter the title of the book you want to borrow: ";
+        getline(cin, title);
+
+        browsing.lock();
+        Book* book = findBook(category, title);
+        if (!book) {
+            cout << "Book not found in category '" << category << "'.\n";
+            printSuggestions(title, false);
+        } else if (isChosen(requests, category, book->title)) {
+            cout << "You have already chosen this book.\n";
+        } else if (hasBorrowedSpecificBook(borrowerId, title, category)) {
+            cout << "Sorry, you have already borrowed a copy of this book.\n";
+        } else if (book->availableCopies <= 0) {
+            cout << "Sorry, no copies of this book are currently available.\n";
+        } else {
+            requests.push_back(LoanRequest{category, book->title});
+            continue;
+        }
+        cout << "Please choose another book.\n";
     }
 
-    cout << "\nFound borrow record:\n";
-    cout << "Borrowed 1 copy on " << selectedRecord->borrowDate
-         << " (Due: " << selectedRecord->returnDate << ")\n";
+    displayBorrowRules();
 
+    cout << "\nBooks to borrow:\n";
+    for (size_t i = 0; i < requests.size(); i++) {
+        cout << " " << i + 1 << ". " << requests[i].title << " (" << requests[i].category << ")\n";
+    }
     char confirm;
-    cout << "Confirm return of 1 copy of '" << title << "'? (y/n): ";
+    cout << "Do you want to proceed with borrowing these " << requests.size() << " books? (y/n): ";
     cin >> confirm;
     cin.ignore();
-
     if (tolower(confirm) != 'y') {
-        cout << "Return cancelled.\n";
+        cout << "Borrowing cancelled.\n";
         return;
     }
 
-    string returnDate = getCurrentDateTime();
-    int daysLate = daysBetweenDates(selectedRecord->returnDate, returnDate);
-
-    book->availableCopies += 1;
-    saveToFile();
+    vector<LoanStatus> statuses;
+    vector<BorrowRecord*> records;
+    LoanStatus status;
+    time_t borrowDate = 0, returnDate = 0;
+    {
+        WriteLock lock(libraryLock);
+        status = checkoutBooks(requests, borrowerName, borrowerId, statuses, records);
+        if (status == LOAN_OK) {
+            borrowDate = records[0]->borrowDate;
+            returnDate = records[0]->returnDate;
+        }
+    }
+    waitForJournals();
 
-    selectedRecord->borrowedCopies = 0;
-    selectedRecord->returned = true;
-    saveBorrowRecords();
+    if (status != LOAN_OK) {
+        cout << "No books were borrowed:\n";
+        for (size_t i = 0; i < requests.size(); i++) {
+            if (statuses[i] != LOAN_OK) {
+                cout << " " << requests[i].title << ": " << loanStatusMessage(statuses[i]) << "\n";
+            }
+        }
+        return;
+    }
 
-    cout << "\n>>>>>>> Return Confirmation <<<<<<<<\n";
-    cout << " Book Title: " << title << "\n";
-    cout << " Category: " << category << "\n";
+    cout << "\n--------- Borrowing Confirmation -----------\n";
+    for (size_t i = 0; i < requests.size(); i++) {
+        cout << " " << i + 1 << ". " << requests[i].title << " (" << requests[i].category << ")\n";
+    }
     cout << " Borrower Name: " << borrowerName << "\n";
     cout << " Borrower ID: " << borrowerId << "\n";
-    cout << " Copies Returned: 1\n";
-    cout << " Return Date: " << returnDate << "\n";
+    cout << " Copies Borrowed: " << requests.size() << "\n";
+    cout << " Borrow Date: " << formatDateTime(borrowDate) << "\n";
+    cout << " Due Date: " << formatDateTime(returnDate) << "\n";
+    cout << "-------------------------------------\n";
+    cout << "Thank you for borrowing from our library!\n";
+}
 
-    if (daysLate > 0) {
-        int fine = daysLate * 5;
-        cout << " WARNING: This return is " << daysLate << " days late!\n";
-        cout << " Fine imposed: " << fine << " birr\n";
-        cout << " Please pay the fine at the library desk.\n";
+void displayMyLoans() {
+    string borrowerId;
+    if (!readBorrowerId(borrowerId)) {
+        return;
+    }
+
+    ReadLock lock(libraryLock);
+    const vector<BorrowRecord*>* loans = findActiveLoans(borrowerId);
+    if (!loans) {
+        cout << "You have no books on loan.\n";
+        return;
+    }
+
+    time_t now = time(0);
+    cout << "\n--------- Books on Loan to " << symbolName((*loans)[0]->borrowerName) << " -----------\n";
+    for (size_t i = 0; i < loans->size(); i++) {
+        BorrowRecord* record = (*loans)[i];
+        cout << " Title: " << record->book->title << "\n";
+        cout << " Category: " << symbolName(record->book->category) << "\n";
+        cout << " Borrow Date: " << formatDateTime(record->borrowDate) << "\n";
+        cout << " Due Date: " << formatDateTime(record->returnDate) << "\n";
+        int daysLate = daysBetweenDates(record->returnDate, now);
+        if (daysLate > 0) {
+            cout << " OVERDUE by " << daysLate << " days (fine so far: " << calculateFine(daysLate) << " birr)\n";
+        }
+        cout << "-------------------------\n";
+    }
+}
+
+// Pops every overdue loan off the due-date heap (discarding returned ones),
+// reports them oldest first, then pushes them back: O(k log n). Reordering
+// the heap needs the exclusive lock.
+void displayOverdueReport() {
+    WriteLock lock(libraryLock);
+    time_t now = time(0);
+    vector<BorrowRecord*> overdue;
+    while (!dueHeap.empty() && dueHeap.front()->returnDate < now) {
+        BorrowRecord* record = dueHeap.front();
+        pop_heap(dueHeap.begin(), dueHeap.end(), DueLater());
+        dueHeap.pop_back();
+        if (record->returned) {
+            staleDueEntries--;
+        } else {
+            overdue.push_back(record);
+        }
+    }
+
+    cout << "\n--------- Overdue Loans -----------\n";
+    int totalFines = 0;
+    int listed = 0;
+    for (size_t i = 0; i < overdue.size(); i++) {
+        BorrowRecord* record = overdue[i];
+        int daysLate = daysBetweenDates(record->returnDate, now);
+        dueHeap.push_back(record);
+        push_heap(dueHeap.begin(), dueHeap.end(), DueLater());
+        if (daysLate <= 0) {
+            continue;
+        }
+        int fine = calculateFine(daysLate);
+        totalFines += fine;
+        listed++;
+        cout << " Title: " << record->book->title << " (" << symbolName(record->book->category) << ")\n";
+        cout << " Borrower: " << symbolName(record->borrowerName) << " [" << symbolName(record->borrowerId) << "]\n";
+        cout << " Due Date: " << formatDateTime(record->returnDate) << "\n";
+        cout << " Days late: " << daysLate << ", fine: " << fine << " birr\n";
+        cout << "-------------------------\n";
+    }
+
+    if (listed == 0) {
+        cout << " No overdue loans.\n";
     } else {
-        cout << " Book returned on time. Thank you!\n";
+        cout << " " << listed << " overdue loans, " << totalFines << " birr in fines.\n";
+    }
+}
+
+// Runs node destructors, then hands every slab back at once instead of
+// freeing nodes one by one.
+void cleanup() {
+    stopJournalWriter();
+    for (Book* temp = head; temp; ) {
+        Book* next = temp->next;
+        temp->~Book();
+        temp = next;
+    }
+    for (size_t i = 0; i < retiredBooks.size(); i++) {
+        retiredBooks[i]->~Book();
+    }
+    for (BorrowRecord* temp = borrowHead; temp; ) {
+        BorrowRecord* next = temp->next;
+        temp->~BorrowRecord();
+        temp = next;
+    }
+    head = tail = NULL;
+    borrowHead = borrowTail = NULL;
+    bookPool.releaseAll();
+    borrowPool.releaseAll();
+
+    for (size_t i = 0; i < categories.size(); i++) {
+        delete categories[i];
+    }
+    categories.clear();
+    categoryIndex.clear();
+    bookIndex.clear();
+    retiredBooks.clear();
+    retiredBookIndex.clear();
+    columns = CatalogueColumns();
+    titleOrder.clear();
+    titleTrigrams.clear();
+    booksBySerial.clear();
+    titleSearchReady = false;
+    authorTrigrams.clear();
+    authorBookCounts.clear();
+    authorSearchReady = false;
+    authorIndex.clear();
+    yearIndex.clear();
+    queryIndexReady = false;
+    symbolIds.clear();
+    symbolNames.clear();
+    activeLoans.clear();
+    dueHeap.clear();
+
+    if (libraryJournal.file) {
+        fclose(libraryJournal.file);
+        libraryJournal.file = NULL;
+    }
+}
+
+int getMenuChoice() {
+    int choice;
+    cout << "\n========== Dilla University Library ==========\n";
+    cout << "1. Add Books\n";
+    cout << "2. Display Books\n";
+    cout << "3. Search Book\n";
+    cout << "4. Delete Book Copies\n";
+    cout << "5. Count Books\n";
+    cout << "6. Sort Books\n";
+    cout << "7. Delete All Books\n";
+    cout << "8. Update Book\n";
+    cout << "9. Borrow One Book\n";
+    cout << "10. Borrow Multiple Books\n";
+    cout << "11. Return Book\n";
+    cout << "12. My Loans\n";
+    cout << "13. Overdue Report\n";
+    cout << "14. Find Books\n";
+    cout << "15. Exit\n";
+    if (!getSafeInt(choice, "Enter your choice (1-15): ", 1, 15)) {
+        return 15;
+    }
+    return choice;
+}
+
+// Writes `lines` synthetic book and borrow lines, then times the loaders.
+void benchmarkLoad(int lines) {
+    const string bookPath = "bench_library_data.txt";
+    const string borrowPath = "bench_borrow_records.txt";
+    const char* categoryNames[] = {"Fiction", "History", "Computer Science", "Poetry", "Science"};
+
+    ofstream books(bookPath.c_str());
+    ofstream borrows(borrowPath.c_str());
+    for (int i = 0; i < lines; i++) {
+        books << "Benchmark Title " << i << "|Author Number " << (i % 5000) << "|"
+              << (1800 + i % 226) << "|" << (1 + i % 20) << "|" << (i % 20) << "|"
+              << categoryNames[i % 5] << "|1792144800\n";
+        borrows << "Benchmark Title " << i << "|" << categoryNames[i % 5]
+                << "|Borrower Name|ID" << (i % 100000) << "|1|1792144800"
+                << "|1793354400|" << (i % 3 == 0 ? "0" : "1") << "\n";
+    }
+    books.close();
+    borrows.close();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long generation;
+    loadTextSnapshot(bookPath, BookLineLoader(), generation);
+    chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+    loadTextSnapshot(borrowPath, BorrowLineLoader(), generation);
+    chrono::steady_clock::time_point finish = chrono::steady_clock::now();
+
+    double bookMs = chrono::duration<double, milli>(middle - start).count();
+    double borrowMs = chrono::duration<double, milli>(finish - middle).count();
+    cout << "Loaded " << lines << " book lines in " << bookMs << " ms ("
+         << (long)(lines / (bookMs / 1000)) << " lines/s)\n";
+    cout << "Loaded " << lines << " borrow lines in " << borrowMs << " ms ("
+         << (long)(lines / (borrowMs / 1000)) << " lines/s)\n";
+    cout << "Node allocations: " << bookPool.created() << " books in "
+         << bookPool.slabAllocations() << " slabs, " << borrowPool.created()
+         << " borrow records in " << borrowPool.slabAllocations() << " slabs\n";
+
+    chrono::steady_clock::time_point teardownStart = chrono::steady_clock::now();
+    cleanup();
+    double teardownMs = chrono::duration<double, milli>(chrono::steady_clock::now() - teardownStart).count();
+    cout << "Released all nodes in " << teardownMs << " ms\n";
+
+    remove(bookPath.c_str());
+    remove(borrowPath.c_str());
+}
+
+// The byte-at-a-time compare caseInsensitiveCompare used before the SIMD
+// versions; kept as the --bench-compare baseline.
+bool tolowerCompare(const string& str1, const string& str2) {
+    if (str1.length() != str2.length()) {
+        return false;
+    }
+    for (size_t i = 0; i < str1.length(); ++i) {
+        if (tolower(str1[i]) != tolower(str2[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Compare>
+double timeCompares(const vector<string>& left, const vector<string>& right, Compare compare, int& matches) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    matches = 0;
+    for (size_t i = 0; i < left.size(); i++) {
+        matches += compare(left[i], right[i]);
+    }
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+struct FoldedEqualsCompare {
+    FoldedEqualsFunction function;
+    bool operator()(const string& a, const string& b) const {
+        return a.length() == b.length() && function(a.data(), b.data(), a.length());
+    }
+};
+
+// Checks every compare variant against tolower() and times them on
+// mixed-case title pairs, then times a title lookup scan with and without
+// the cached hash.
+void benchmarkCompare(int pairs) {
+    vector<pair<const char*, FoldedEqualsFunction> > variants;
+    variants.push_back(make_pair("scalar", &foldedEqualsScalar));
+#ifdef LIBRARY_HAVE_SSE2
+    variants.push_back(make_pair("SSE2", &foldedEqualsSSE2));
+#endif
+#ifdef LIBRARY_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        variants.push_back(make_pair("AVX2", &foldedEqualsAVX2));
+    }
+#endif
+
+    // Every byte pair at every position of a 40-byte string, so the bytes
+    // covered by the 16- and 32-byte blocks are checked as well as the tail.
+    bool agree = true;
+    int firstMismatch = -1;
+    for (int position = 0; position < 40; position++) {
+        string a(40, 'q');
+        string b(40, 'Q');
+        for (int x = 0; x < 256; x++) {
+            for (int y = 0; y < 256; y++) {
+                a[position] = (char)x;
+                b[position] = (char)y;
+                bool expected = tolowerCompare(a, b);
+                bool matches = caseInsensitiveCompare(a, b) == expected;
+                for (size_t v = 0; v < variants.size(); v++) {
+                    matches = matches && FoldedEqualsCompare{variants[v].second}(a, b) == expected;
+                }
+                if (!matches && agree) {
+                    agree = false;
+                    firstMismatch = position;
+                }
+            }
+        }
+    }
+
+    vector<string> left, right;
+    for (int i = 0; i < pairs; i++) {
+        string title = "Benchmark Title Number " + to_string(i) + " With A Longer Subtitle";
+        string upper = title;
+        transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        left.push_back(title);
+        right.push_back(i % 2 ? upper : upper.substr(0, upper.size() - 1) + "!");
+    }
+
+    cout << "Variants agree with tolower() at every position: "
+         << (agree ? "yes" : "NO, first difference at byte " + to_string(firstMismatch)) << "\n";
+    cout << "Comparing " << pairs << " equal-length title pairs:\n";
+    int expectedMatches;
+    double baseMs = timeCompares(left, right, tolowerCompare, expectedMatches);
+    cout << " tolower loop: " << baseMs << " ms\n";
+    for (size_t v = 0; v < variants.size(); v++) {
+        int matches;
+        double ms = timeCompares(left, right, FoldedEqualsCompare{variants[v].second}, matches);
+        cout << " " << variants[v].first << ": " << ms << " ms (" << baseMs / ms << "x"
+             << (matches == expectedMatches ? "" : ", WRONG RESULT") << ")\n";
+    }
+
+    vector<Book*> books;
+    for (int i = 0; i < pairs; i++) {
+        books.push_back(addBookToList(left[i], "Benchmark Author", 2000, "Fiction", 1792144800, 1, 1));
+    }
+    string missing = "Benchmark Title Number 12345 With A Longer Subtitlf";
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int found = 0;
+    for (size_t i = 0; i < books.size(); i++) {
+        found += tolowerCompare(books[i]->title, missing);
+    }
+    chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+    FoldedTitle folded = foldTitle(missing);
+    for (size_t i = 0; i < books.size(); i++) {
+        found += titleMatches(books[i], folded);
+    }
+    chrono::steady_clock::time_point finish = chrono::steady_clock::now();
+    double scanMs = chrono::duration<double, milli>(middle - start).count();
+    double cachedMs = chrono::duration<double, milli>(finish - middle).count();
+    cout << "Scanning " << pairs << " books for a missing title:\n";
+    cout << " tolower loop: " << scanMs << " ms\n";
+    cout << " cached hash:  " << cachedMs << " ms (" << scanMs / cachedMs << "x, "
+         << found << " found)\n";
+    cleanup();
+}
+
+// Times keystroke-by-keystroke title searches over generated books built
+// from a small vocabulary, so common words have long posting lists.
+void benchmarkSearch(int books) {
+    const char* words[] = {"history", "of", "the", "modern", "world", "introduction", "to",
+                           "algorithms", "data", "structures", "ethiopian", "poetry", "river",
+                           "mountain", "science", "art", "love", "war", "peace", "letters",
+                           "empire", "garden", "children", "ocean", "city", "night", "dawn",
+                           "kingdom", "journey", "silent", "golden", "ancient", "coffee"};
+    const int wordCount = sizeof(words) / sizeof(words[0]);
+    uint32_t seed = 12345;
+    vector<string> titles;
+    for (int i = 0; i < books; i++) {
+        string title;
+        int length = 3 + i % 4;
+        for (int w = 0; w < length; w++) {
+            seed = seed * 1103515245 + 12345;
+            title += string(w ? " " : "") + words[(seed >> 16) % wordCount];
+        }
+        title += " " + string(1, 'a' + i % 26) + string(1, 'a' + i / 26 % 26) + string(1, 'a' + i / 676 % 26);
+        titles.push_back(title);
+        addBookToList(title, "Benchmark Author", 2000, "Fiction", 1792144800, 1, 1);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    buildTitleSearch();
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    vector<string> queries;
+    const char* typed[] = {titles[books / 2].c_str(), "ethiopian poetry", "golden coffee", "dawn kin",
+                           "rithm", "ocean city night"};
+    for (size_t t = 0; t < sizeof(typed) / sizeof(typed[0]); t++) {
+        string text = typed[t];
+        for (size_t i = 1; i <= text.size(); i++) {
+            queries.push_back(text.substr(0, i));
+        }
+    }
+
+    double totalMs = 0, worstMs = 0;
+    string worstQuery;
+    size_t results = 0;
+    for (size_t q = 0; q < queries.size(); q++) {
+        chrono::steady_clock::time_point queryStart = chrono::steady_clock::now();
+        results += searchTitles(queries[q], SEARCH_RESULT_LIMIT).size();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - queryStart).count();
+        totalMs += ms;
+        if (ms > worstMs) {
+            worstMs = ms;
+            worstQuery = queries[q];
+        }
+    }
+
+    cout << "Indexed " << books << " titles in " << buildMs << " ms\n";
+    cout << queries.size() << " keystroke queries: " << totalMs / queries.size() * 1000
+         << " us average, worst " << worstMs * 1000 << " us ('" << worstQuery << "'), "
+         << results << " results\n";
+
+    // Misspell titles with a swap and a dropped letter and check the
+    // original comes back as a suggestion.
+    const int typoQueries = 200;
+    int recovered = 0;
+    totalMs = worstMs = 0;
+    for (int q = 0; q < typoQueries; q++) {
+        string typo = titles[(size_t)q * 7919 % books];
+        size_t at = 1 + q % (typo.size() - 3);
+        swap(typo[at], typo[at + 1]);
+        typo.erase(typo.size() / 2, 1);
+        chrono::steady_clock::time_point queryStart = chrono::steady_clock::now();
+        vector<FuzzyMatch> suggestions = suggestTitles(typo, SUGGESTION_LIMIT);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - queryStart).count();
+        totalMs += ms;
+        worstMs = max(worstMs, ms);
+        for (size_t i = 0; i < suggestions.size(); i++) {
+            if (booksBySerial[suggestions[i].id]->title == titles[(size_t)q * 7919 % books]) {
+                recovered++;
+                break;
+            }
+        }
+    }
+    cout << typoQueries << " misspelled titles: " << totalMs / typoQueries * 1000 << " us average, worst "
+         << worstMs * 1000 << " us, original suggested for " << recovered << "\n";
+    cleanup();
+}
+
+// Times findBooks() against a plain walk of the book list for a few
+// typical queries over generated books.
+void benchmarkQuery(int books) {
+    const char* categoryNames[] = {"Fiction", "History", "Computer Science", "Poetry", "Science"};
+    for (int i = 0; i < books; i++) {
+        addBookToList("Benchmark Title " + to_string(i), "Author Number " + to_string(i % 5000),
+                      1800 + i % 226, categoryNames[i % 5], 1792144800, 1 + i % 20, i % 20);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    buildQueryIndex();
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Indexed " << books << " books by author and year in " << buildMs << " ms\n";
+
+    vector<pair<string, BookQuery> > queries;
+    BookQuery query = anyBook();
+    query.category = findSymbol("Computer Science");
+    query.fromYear = 2006;
+    query.availableOnly = true;
+    queries.push_back(make_pair("Computer Science after 2005, available", query));
+    query = anyBook();
+    query.author = findSymbol("Author Number 42");
+    queries.push_back(make_pair("everything by one author", query));
+    query = anyBook();
+    query.fromYear = query.toYear = 1999;
+    queries.push_back(make_pair("published in 1999", query));
+    query = anyBook();
+    query.availableOnly = true;
+    queries.push_back(make_pair("all available books", query));
+
+    const int rounds = 5;
+    for (size_t q = 0; q < queries.size(); q++) {
+        QueryPlan plan = PLAN_COLUMN_SCAN;
+        size_t found = 0, scanned = 0;
+        chrono::steady_clock::time_point queryStart = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            found = findBooks(queries[q].second, &plan).size();
+        }
+        chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            vector<Book*> results;
+            for (Book* temp = head; temp; temp = temp->next) {
+                if (bookMatches(temp, queries[q].second)) results.push_back(temp);
+            }
+            scanned = results.size();
+        }
+        chrono::steady_clock::time_point finish = chrono::steady_clock::now();
+        double indexedMs = chrono::duration<double, milli>(middle - queryStart).count() / rounds;
+        double listMs = chrono::duration<double, milli>(finish - middle).count() / rounds;
+        cout << " " << queries[q].first << ": " << found << " books via " << queryPlanName(plan)
+             << " in " << indexedMs << " ms, list walk " << listMs << " ms"
+             << (found == scanned ? "" : " (RESULTS DIFFER)") << "\n";
+    }
+    cleanup();
+}
+
+// Compares list-walking statistics against the columnar scans over
+// generated books that are never written to disk.
+void benchmarkStats(int books) {
+    const char* categoryNames[] = {"Fiction", "History", "Computer Science", "Poetry", "Science"};
+    for (int i = 0; i < books; i++) {
+        addBookToList("Benchmark Title " + to_string(i), "Author Number " + to_string(i % 5000),
+                      1800 + i % 226, categoryNames[i % 5], 1792144800, 1 + i % 20, i % 20);
+    }
+
+    const int rounds = 20;
+    Symbol history = findSymbol("History");
+    long long checksum = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        checksum += listStats(NO_SYMBOL).totalCopies + listStats(history).availableCopies;
+    }
+    chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        checksum -= columnStats(NO_SYMBOL).totalCopies + columnStats(history).availableCopies;
+    }
+    chrono::steady_clock::time_point finish = chrono::steady_clock::now();
+
+    CatalogueStats fromList = listStats(history);
+    CatalogueStats fromColumns = columnStats(history);
+    bool same = checksum == 0 && fromList.bookCount == fromColumns.bookCount &&
+           fromList.oldestYear == fromColumns.oldestYear &&
+           fromList.newestYear == fromColumns.newestYear;
+
+    double listMs = chrono::duration<double, milli>(middle - start).count() / (2 * rounds);
+    double columnMs = chrono::duration<double, milli>(finish - middle).count() / (2 * rounds);
+    cout << "Statistics over " << books << " books (average of " << 2 * rounds << " scans):\n";
+    cout << " Linked list: " << listMs << " ms per scan\n";
+    cout << " Columns:     " << columnMs << " ms per scan (" << listMs / columnMs << "x faster)\n";
+    cout << " Results " << (same ? "match" : "DIFFER") << "\n";
+    cleanup();
+}
+
+// Times a full listing written field by field with << (the old display
+// loop) against writeCatalogueListing(), then single pages at the start,
+// middle and end, over generated books. Listings go to a scratch file that
+// is removed afterwards.
+void benchmarkListing(int books) {
+    const char* categoryNames[] = {"Fiction", "History", "Computer Science", "Poetry", "Science"};
+    for (int i = 0; i < books; i++) {
+        addBookToList("Benchmark Title " + to_string(i), "Author Number " + to_string(i % 5000),
+                      1800 + i % 226, categoryNames[i % 5], 1792144800 + (i % 1000) * 86400, 1 + i % 20, i % 20);
+    }
+    const string path = "bench_listing.txt";
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    {
+        ofstream out(path.c_str());
+        for (size_t c = 0; c < categories.size(); c++) {
+            out << "\n--- Books in Category: " << symbolName(categories[c]->symbol) << " ---\n";
+            for (Book* temp = categories[c]->first; temp; temp = temp->categoryNext) {
+                out << " Title: " << temp->title << "\n";
+                out << " Author: " << symbolName(temp->author) << "\n";
+                out << " Year: " << temp->year << "\n";
+                out << " Added on: " << formatDateTime(temp->addedDate) << "\n";
+                out << " Copies: " << temp->availableCopies << "/" << temp->totalCopies << " available\n";
+                out << "-------------------------\n";
+            }
+        }
+    }
+    chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+    size_t written;
+    exportCatalogue(path, written);
+    chrono::steady_clock::time_point finish = chrono::steady_clock::now();
+
+    double fieldMs = chrono::duration<double, milli>(middle - start).count();
+    double bufferedMs = chrono::duration<double, milli>(finish - middle).count();
+    cout << "Listing " << written << " books:\n";
+    cout << " Field by field: " << fieldMs << " ms\n";
+    cout << " Buffered:       " << bufferedMs << " ms (" << fieldMs / bufferedMs << "x faster)\n";
+
+    size_t offsets[] = {0, (size_t)books / 2, (size_t)max(books - LISTING_PAGE_SIZE, 0)};
+    for (int i = 0; i < 3; i++) {
+        ostringstream page;
+        chrono::steady_clock::time_point pageStart = chrono::steady_clock::now();
+        writeCatalogueListing(page, NO_SYMBOL, offsets[i], LISTING_PAGE_SIZE);
+        double pageMs = chrono::duration<double, milli>(chrono::steady_clock::now() - pageStart).count();
+        cout << " Page of " << LISTING_PAGE_SIZE << " at offset " << offsets[i] << ": " << pageMs << " ms\n";
+    }
+    remove(path.c_str());
+    cleanup();
+}
+
+// Several desk terminals borrow the same few books and return what they lent
+// while also searching and totalling the catalogue; afterwards the ledger
+// is checked: no book below zero copies, every lent copy matched by exactly
+// one active loan, every return of a recorded loan accepted. Runs in memory
+// only.
+void stressTest(int threads) {
+    const int books = 40;
+    const int copiesEach = 3;
+    const int borrowers = 60;
+    const int operations = 20000;
+    const char* categoryNames[] = {"Fiction", "History", "Computer Science"};
+    for (int i = 0; i < books; i++) {
+        addBookToList("Stress Title " + to_string(i), "Stress Author " + to_string(i % 7),
+                      1950 + i, categoryNames[i % 3], time(0), copiesEach, copiesEach);
+    }
+    prepareSearchIndexes();
+
+    atomic<long> borrowed(0), returned(0), refused(0), reads(0), violations(0);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(thread([&, t]() {
+            mt19937 random(t + 1);
+            vector<pair<int, string> > myLoans;
+            for (int op = 0; op < operations; op++) {
+                int b = random() % books;
+                int kind = random() % 4;
+                if (kind == 1 && !myLoans.empty()) {
+                    size_t pick = random() % myLoans.size();
+                    b = myLoans[pick].first;
+                    string borrowerId = myLoans[pick].second;
+                    myLoans[pick] = myLoans.back();
+                    myLoans.pop_back();
+                    WriteLock lock(libraryLock);
+                    int daysLate = 0;
+                    if (checkinBook(categoryNames[b % 3], "Stress Title " + to_string(b), "Stress Reader",
+                                    borrowerId, time(0), daysLate) == LOAN_OK) {
+                        returned++;
+                    } else {
+                        violations++;
+                    }
+                } else if (kind <= 1) {
+                    string borrowerId = "ID" + to_string(t) + "x" + to_string(random() % borrowers);
+                    WriteLock lock(libraryLock);
+                    BorrowRecord* record = NULL;
+                    LoanStatus status = checkoutBook(categoryNames[b % 3], "Stress Title " + to_string(b),
+                                                     "Stress Reader", borrowerId, record);
+                    if (status == LOAN_OK) {
+                        borrowed++;
+                        myLoans.push_back(make_pair(b, borrowerId));
+                    } else if (status == LOAN_NO_COPIES) {
+                        refused++;
+                    }
+                } else {
+                    string title = "Stress Title " + to_string(b);
+                    ReadLock lock(libraryLock);
+                    Book* book = findBook(categoryNames[b % 3], title);
+                    CatalogueStats stats = columnStats(NO_SYMBOL);
+                    if (!book || book->availableCopies < 0 || book->availableCopies > book->totalCopies ||
+                        stats.availableCopies < 0 || searchTitles(title, 1).empty()) {
+                        violations++;
+                    }
+                    reads++;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    unordered_map<Book*, int> lent;
+    long activeCount = 0;
+    for (auto it = activeLoans.begin(); it != activeLoans.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            lent[it->second[i]->book]++;
+            activeCount++;
+        }
+    }
+    for (Book* temp = head; temp; temp = temp->next) {
+        if (temp->availableCopies < 0 || temp->totalCopies - temp->availableCopies != lent[temp]) {
+            violations++;
+        }
+    }
+    if (activeCount != borrowed - returned) {
+        violations++;
+    }
+
+    cout << "Stress test: " << threads << " threads x " << operations << " operations on "
+         << books << " books of " << copiesEach << " copies\n";
+    cout << " " << borrowed << " borrows, " << returned << " returns, " << refused
+         << " refused for lack of copies, " << reads << " reads in " << elapsedMs << " ms\n";
+    cout << " " << activeCount << " loans still active; "
+         << (violations == 0 ? "ledger consistent" : to_string(violations) + " INCONSISTENCIES") << "\n";
+    cleanup();
+}
+
+#ifndef _WIN32
+// Service mode (--serve): kiosks and other programs drive a headless
+// library over a Unix domain socket. Each request is one line of
+// '|'-separated fields:
+//   PING
+//   SEARCH|text
+//   BORROW|category|title|name|id
+//   RETURN|category|title|name|id
+//   ADD|title|author|year|category|copies
+//   STATS
+// A client sends any number of request lines followed by an empty line.
+// The batch runs under one lock, its journal entries are group-committed
+// together (with those of other clients), and the replies (one per
+// request, in order, then an empty line) go back in one write once they are
+// durable. Replies start with OK or ERR|CODE|message; SEARCH replies OK|n
+// followed by n lines of title|author|category|available|total, STATS
+// replies OK|flushes|changes|largestBatch|averageFlushMs|slowestFlushMs.
+// An empty line with no requests before it gets one ERR|EMPTY_BATCH reply,
+// so every batch is answered by at least one line before its terminator.
+const size_t SERVICE_MAX_LINE = 4096;
+const size_t SERVICE_MAX_BATCH = 256;
+
+int serviceSocket = -1;
+atomic<bool> serviceStopping(false);
+mutex serviceClientsMutex;
+condition_variable serviceClientsDone;
+vector<int> serviceClients;
+
+// Same identity addBooks uses: title and author, in any category. Needs
+// the query index.
+Book* findBookByAuthor(const string& title, const string& author) {
+    auto it = authorIndex.find(findSymbol(author));
+    if (it == authorIndex.end()) {
+        return NULL;
+    }
+    FoldedTitle folded = foldTitle(title);
+    for (size_t i = 0; i < it->second.size(); i++) {
+        if (titleMatches(it->second[i], folded)) {
+            return it->second[i];
+        }
+    }
+    return NULL;
+}
+
+bool isServiceUpdate(const string& line) {
+    string command = line.substr(0, line.find('|'));
+    return command == "BORROW" || command == "RETURN" || command == "ADD";
+}
+
+// Runs one request and appends its reply. The caller holds libraryLock,
+// exclusively if the request changes anything.
+void serveRequest(const string& line, string& reply) {
+    vector<string> fields = splitFields(line);
+    const string& command = fields[0];
+
+    if (command == "PING" && fields.size() == 1) {
+        reply += "OK\n";
+    } else if (command == "STATS" && fields.size() == 1) {
+        GroupCommitStats stats = readGroupCommitStats();
+        ostringstream out;
+        out << "OK|" << stats.flushes << "|" << stats.changes << "|" << stats.largestBatch << "|"
+            << (stats.flushes ? stats.totalFlushMs / stats.flushes : 0) << "|" << stats.slowestFlushMs << "\n";
+        reply += out.str();
+    } else if (command == "SEARCH" && fields.size() == 2) {
+        vector<TitleMatch> matches = searchTitles(fields[1], SEARCH_RESULT_LIMIT);
+        reply += "OK|" + to_string(matches.size()) + "\n";
+        for (size_t i = 0; i < matches.size(); i++) {
+            Book* book = matches[i].book;
+            reply += book->title + "|" + symbolName(book->author) + "|" + symbolName(book->category) + "|" +
+                     to_string(book->availableCopies) + "|" + to_string(book->totalCopies) + "\n";
+        }
+    } else if ((command == "BORROW" || command == "RETURN") && fields.size() == 5) {
+        if (checkLettersAndSpaces(fields[3], 3) != INPUT_OK || fields[4].length() < 3) {
+            reply += "ERR|INVALID|name must be at least 3 letters and spaces, ID at least 3 characters\n";
+            return;
+        }
+        LoanStatus status;
+        if (command == "BORROW") {
+            BorrowRecord* record = NULL;
+            status = checkoutBook(fields[1], fields[2], fields[3], fields[4], record);
+            if (status == LOAN_OK) {
+                reply += "OK|" + to_string((long long)record->returnDate) + "\n";
+            }
+        } else {
+            int daysLate = 0;
+            status = checkinBook(fields[1], fields[2], fields[3], fields[4], time(0), daysLate);
+            if (status == LOAN_OK) {
+                daysLate = max(daysLate, 0);
+                reply += "OK|" + to_string(daysLate) + "|" + to_string(calculateFine(daysLate)) + "\n";
+            }
+        }
+        if (status != LOAN_OK) {
+            reply += "ERR|" + loanStatusCode(status) + "|" + loanStatusMessage(status) + "\n";
+        }
+    } else if (command == "ADD" && fields.size() == 6) {
+        vector<string> row(fields.begin() + 1, fields.end());
+        int year = 0, copies = 0;
+        string reason = checkImportRow(row, year, copies);
+        if (!reason.empty()) {
+            reply += "ERR|INVALID|" + reason + "\n";
+            return;
+        }
+        Book* book = findBookByAuthor(row[0], row[1]);
+        if (book) {
+            book->totalCopies += copies;
+            book->availableCopies += copies;
+            journalBook(book);
+            reply += "OK|merged|" + to_string(book->totalCopies) + "\n";
+        } else {
+            book = addBookToList(row[0], row[1], year, row[3], time(0), copies, copies);
+            journalBook(book);
+            reply += "OK|added|" + to_string(book->totalCopies) + "\n";
+        }
+    } else {
+        reply += "ERR|BAD_REQUEST|unknown command or wrong number of fields\n";
+    }
+}
+
+void serveBatch(const vector<string>& batch, string& reply) {
+    if (batch.empty()) {
+        reply += "ERR|EMPTY_BATCH|no requests before the empty line\n\n";
+        return;
+    }
+    bool updates = false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        updates = updates || isServiceUpdate(batch[i]);
+    }
+    prepareSearchIndexes();
+    if (updates) {
+        {
+            WriteLock lock(libraryLock);
+            beginJournalGroup();
+            for (size_t i = 0; i < batch.size(); i++) {
+                serveRequest(batch[i], reply);
+            }
+            commitJournalGroup();
+        }
+        waitForJournals();
+    } else {
+        ReadLock lock(libraryLock);
+        for (size_t i = 0; i < batch.size(); i++) {
+            serveRequest(batch[i], reply);
+        }
+    }
+    reply += "\n";
+}
+
+bool sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+void serveConnection(int fd) {
+    char buffer[4096];
+    string pending, reply;
+    vector<string> batch;
+    bool open = true;
+    while (open) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        pending.append(buffer, n);
+
+        size_t start = 0, end;
+        while (open && (end = pending.find('\n', start)) != string::npos) {
+            string line = pending.substr(start, end - start);
+            start = end + 1;
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            if (!line.empty() && batch.size() == SERVICE_MAX_BATCH) {
+                sendAll(fd, "ERR|BAD_REQUEST|more than " + to_string(SERVICE_MAX_BATCH) + " requests in one batch\n\n");
+                open = false;
+            } else if (!line.empty()) {
+                batch.push_back(line);
+            } else {
+                reply.clear();
+                serveBatch(batch, reply);
+                batch.clear();
+                open = sendAll(fd, reply);
+            }
+        }
+        pending.erase(0, start);
+        if (open && pending.size() > SERVICE_MAX_LINE) {
+            sendAll(fd, "ERR|BAD_REQUEST|request line too long\n\n");
+            open = false;
+        }
+    }
+
+    lock_guard<mutex> lock(serviceClientsMutex);
+    serviceClients.erase(find(serviceClients.begin(), serviceClients.end(), fd));
+    close(fd);
+    serviceClientsDone.notify_all();
+}
+
+void stopService(int) {
+    serviceStopping = true;
+    if (serviceSocket >= 0) {
+        shutdown(serviceSocket, SHUT_RDWR);
     }
- cout << "------------------------------------\n";
 }
 
+// Serves clients on `path` until SIGINT or SIGTERM, one thread per
+// connection, then waits for open connections to finish their batch.
+int runService(const string& path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cout << " Error: socket path " << path << " is too long.\n";
+        return 1;
+    }
+    strcpy(address.sun_path, path.c_str());
 
+    if (!lockDataDirectory() || !loadFromFile() || !loadBorrowRecords()) {
+        return 1;
+    }
+    prepareSearchIndexes();
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || ::bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        cout << " Error: could not listen on " << path << ": " << strerror(errno) << "\n";
+        if (listener >= 0) {
+            close(listener);
+        }
+        cleanup();
+        return 1;
+    }
+    startJournalWriter();
+
+    serviceSocket = listener;
+    signal(SIGINT, stopService);
+    signal(SIGTERM, stopService);
+    cout << "Serving the library on " << path << " (Ctrl+C to stop).\n";
+
+    while (!serviceStopping) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        lock_guard<mutex> lock(serviceClientsMutex);
+        serviceClients.push_back(fd);
+        thread(serveConnection, fd).detach();
+    }
 
+    {
+        unique_lock<mutex> lock(serviceClientsMutex);
+        for (size_t i = 0; i < serviceClients.size(); i++) {
+            shutdown(serviceClients[i], SHUT_RD);
+        }
+        serviceClientsDone.wait(lock, []() { return serviceClients.empty(); });
+    }
+    close(listener);
+    unlink(path.c_str());
+    cleanup();
+    cout << "Library service stopped: " << formatGroupCommitStats(readGroupCommitStats()) << ".\n";
+    return 0;
+}
+#endif
 
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && string(argv[1]) == "--bench-load") {
+        benchmarkLoad(argc >= 3 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-compare") {
+        benchmarkCompare(argc >= 3 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-search") {
+        benchmarkSearch(argc >= 3 ? atoi(argv[2]) : 500000);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-query") {
+        benchmarkQuery(argc >= 3 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-stats") {
+        benchmarkStats(argc >= 3 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-listing") {
+        benchmarkListing(argc >= 3 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--stress-test") {
+        stressTest(argc >= 3 ? atoi(argv[2]) : 8);
+        return 0;
+    }
+    if (argc >= 3 && string(argv[1]) == "--serve") {
+#ifdef _WIN32
+        cout << "Service mode needs Unix domain sockets and is not available on Windows.\n";
+        return 1;
+#else
+        return runService(argv[2]);
+#endif
+    }
+    if (argc >= 3 && string(argv[1]) == "--import") {
+        if (!lockDataDirectory() || !loadFromFile() || !loadBorrowRecords()) {
+            return 1;
+        }
+        importCatalogue(argv[2]);
+        cleanup();
+        return 0;
+    }
+    if (argc >= 3 && string(argv[1]) == "--export") {
+        if (!lockDataDirectory() || !loadFromFile() || !loadBorrowRecords()) {
+            return 1;
+        }
+        size_t written = 0;
+        if (!exportCatalogue(argv[2], written)) {
+            cout << " Error: could not write " << argv[2] << ".\n";
+            cleanup();
+            return 1;
+        }
+        cout << "Exported " << written << " books to " << argv[2] << ".\n";
+        cleanup();
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--convert-to-binary") {
+        if (!lockDataDirectory() || !loadFromFile() || !loadBorrowRecords()) {
+            return 1;
+        }
+        saveToFile();
+        cout << "Wrote " << LIBRARY_BINARY_FILE << " and " << BORROW_BINARY_FILE << ".\n";
+        return 0;
+    }
 
-int main() {
-    loadFromFile();
-    loadBorrowRecords();
+    if (!lockDataDirectory() || !loadFromFile() || !loadBorrowRecords()) {
+        return 1;
+    }
+    startJournalWriter();
     int choice;
 
     do {
@@ -1137,15 +5461,18 @@ int main() {
             case 3: searchBooks(); break;
             case 4: deleteBook(); break;
             case 5: countBooksMenu(); break;
-            case 6: sortBooks(); break;
+            case 6: sortBooksMenu(); break;
             case 7: deleteAllBooks(); break;
             case 8:  updateBook(); break;
             case 9:  borrowBook(); break;
             case 10: borrowMultipleBooks(); break;
             case 11: returnBook(); break;
-            case 12: cout << "Exiting Library System.\n"; break;
+            case 12: displayMyLoans(); break;
+            case 13: displayOverdueReport(); break;
+            case 14: findBooksMenu(); break;
+            case 15: cout << "Exiting Library System.\n"; break;
         }
-    } while (choice != 12);
+    } while (choice != 15);
 
     cleanup();
     return 0;